@@ -1,7 +1,11 @@
 @echo off
 
-cd "%~dp0" && if exist nvdv.exe del /f nvdv.exe
+set TARGET=nvdv
+set FLAGS=
+if "%1"=="bench" set TARGET=nvdv-bench& set FLAGS=/DNVDV_BENCHMARK /wd4505
+
+cd "%~dp0" && if exist %TARGET%.exe del /f %TARGET%.exe
 
 if not exist nvapi\amd64\ git.exe submodule update --init --remote
 
-call vcvars64.bat && cl.exe /std:c++latest /MD /O2 /W4 /WX /EHsc nvdv.cpp user32.lib shell32.lib && del /f nvdv.obj
+call vcvars64.bat && cl.exe /std:c++latest /MD /O2 /W4 /WX /EHsc %FLAGS% nvdv.cpp user32.lib shell32.lib /Fe:%TARGET%.exe && del /f nvdv.obj
@@ -5,11 +5,24 @@ CPPFLAGS=(
   -Wall
   -Wextra
   -Werror
-  -luser32
-  -lshell32
   -std=c++23
 )
 
-cd "$(dirname "$0")" && \
-  { [[ -d nvapi/amd64 ]] || git submodule update --init --remote; } && \
-  rm -f nvdv.exe && clang++.exe "${CPPFLAGS[@]}" nvdv.cpp -o nvdv.exe
+cd "$(dirname "$0")" || exit 1
+
+TARGET=nvdv
+if [[ "$1" == bench ]]; then # same translation unit with the entry point replaced by benchmarks
+  TARGET=nvdv-bench
+  # the CLI entry points go unused, and GCC mistakes the counting operator new/delete pair for a mismatch
+  CPPFLAGS+=(-DNVDV_BENCHMARK -Wno-unused-function -Wno-mismatched-new-delete)
+fi
+
+case "$OSTYPE" in
+  msys* | cygwin*)
+    { [[ -d nvapi/amd64 ]] || git submodule update --init --remote; } && \
+      rm -f "$TARGET.exe" && clang++.exe "${CPPFLAGS[@]}" -luser32 -lshell32 nvdv.cpp -o "$TARGET.exe"
+    ;;
+  *) # NvAPI is Windows-only, so other hosts build against the simulated backend
+    rm -f "$TARGET" && "${CXX:-clang++}" "${CPPFLAGS[@]}" -pthread nvdv.cpp -o "$TARGET"
+    ;;
+esac
@@ -1,9 +1,55 @@
 #include <signal.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
 #include <windows.h>
 #include "nvapi/nvapi.h"
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <sys/un.h>
+#include <unistd.h>
+// subset of nvapi.h used by the simulated backend
+typedef unsigned long NvU32;
+typedef struct NvDisplayHandle__* NvDisplayHandle;
+typedef enum _NvAPI_Status {
+  NVAPI_OK = 0,
+  NVAPI_ERROR = -1,
+  NVAPI_INVALID_ARGUMENT = -5,
+  NVAPI_END_ENUMERATION = -7,
+} NvAPI_Status;
+#endif
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <variant>
 #include "CLI11.hpp"
 #include "nvdv.hpp"
 
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+#ifdef _WIN32
 static constexpr int ABORT_SIGNALS[11]{
   NVAPI_ERROR,
   SIGABRT,
@@ -17,207 +63,2762 @@ static constexpr int ABORT_SIGNALS[11]{
   WM_CLOSE,
   WM_QUIT,
 };
+#else
+static constexpr int ABORT_SIGNALS[7]{
+  SIGABRT,
+  SIGFPE,
+  SIGHUP,
+  SIGILL,
+  SIGINT,
+  SIGSEGV,
+  SIGTERM,
+};
+#endif
 
+static bool echo_rejections = true;  // off while a resident instance reports them with the request's own errors
+
+#ifdef _MSC_VER
 #pragma warning(suppress: 4702)  // unreachable
+#endif
 static NvAPI_Status reject(const char* reason) {
-  std::cerr << "Error: " << reason << std::endl;
+  if (echo_rejections) std::cerr << "Error: " << reason << std::endl;
   throw std::runtime_error(reason);
   return NVAPI_ERROR;
 }
 
+/** why a driver call failed for one display (reported alongside the other displays' results instead of thrown) */
+struct Failure {
+  std::string reason;
+  NvAPI_Status status = NVAPI_ERROR;
+};
+
+/** a value, or the `Failure` that prevented it (shaped like `std::expected`, which not every supported library ships) */
+template <typename T = void>
+class [[nodiscard]] Result {
+  using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+  std::variant<Value, Failure> state;
+
+ public:
+  Result() = default;
+  Result(Value value) : state(std::in_place_index<0>, std::move(value)) {}
+  Result(Failure failure) : state(std::in_place_index<1>, std::move(failure)) {}
+
+  explicit operator bool() const { return state.index() == 0; }
+  Value& operator*() { return std::get<0>(state); }
+  Value* operator->() { return &std::get<0>(state); }
+  Failure& error() { return std::get<1>(state); }
+  const Failure& error() const { return std::get<1>(state); }
+};
+
+static Failure fail(std::string reason, const NvAPI_Status status = NVAPI_ERROR) {
+  return Failure{std::move(reason), status};
+}
+
+/** @returns value of environment variable `name` converted to `T`, or `fallback` if unset or invalid */
+template <typename T>
+static T env_or(const char* name, const T fallback) {
+  const std::string value = CLI::detail::get_environment_value(name);
+  T result{};
+  return !value.empty() && CLI::detail::lexical_cast(value, result) ? result : fallback;
+}
+
+/** `--trace` recorder, writing completed spans as a Chrome trace (chrome://tracing, Perfetto) on exit */
+struct Trace {
+  using clock = std::chrono::steady_clock;
+  static inline std::atomic<bool> enabled = false;
+  static inline std::string path;
+
+  /** adds a span from `start` until now on the calling thread */
+  static void record(const char* name, const clock::time_point start) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    static std::atomic<std::size_t> threads = 0;
+    static thread_local const std::size_t thread = threads++;
+    const clock::time_point end = clock::now();
+    const std::lock_guard lock{mutex};
+    events.push_back({name, thread, start, end});
+  }
+
+  /** @returns position to pass to `write_since` for the spans recorded from now on */
+  static std::size_t mark() {
+    const std::lock_guard lock{mutex};
+    return events.size();
+  }
+
+  /** writes every span to `path` (registered to run on exit) */
+  static void write() { write_since(0, path); }
+
+  /** writes the spans recorded since `first` to `file_path` */
+  static void write_since(const std::size_t first, const std::string& file_path) {
+    const std::lock_guard lock{mutex};
+    std::ofstream file{file_path};
+    if (!file) return;
+    const auto micros = [](const clock::duration duration) {
+      return std::chrono::duration<double, std::micro>(duration).count();
+    };
+
+    file << "{\"traceEvents\":[\n";
+    for (std::size_t i = first; i < events.size(); ++i) {
+      const auto& [name, thread, start, end] = events[i];
+      char line[256];
+      std::snprintf(line, sizeof(line), R"({"name":"%s","ph":"X","pid":1,"tid":%zu,"ts":%.3f,"dur":%.3f}%s)" "\n",
+        name, thread, micros(start - epoch), micros(end - start), i + 1 < events.size() ? "," : "");
+      file << line;
+    }
+
+    file << "]}\n";
+  }
+
+ private:
+  struct Event {
+    const char* name;
+    std::size_t thread;
+    clock::time_point start;
+    clock::time_point end;
+  };
+
+  static inline const clock::time_point epoch = clock::now();
+  static inline std::mutex mutex;
+  static inline std::vector<Event> events;
+};
+
+/** scoped `--trace` span (costs a relaxed load and a branch while tracing is off) */
+struct Span {
+  const char* const name;
+  const Trace::clock::time_point start;
+
+  explicit Span(const char* span_name) noexcept
+      : name(span_name),
+        start(Trace::enabled.load(std::memory_order_relaxed) ? Trace::clock::now() : Trace::clock::time_point{}) {}
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+  ~Span() {
+    if (start != Trace::clock::time_point{}) Trace::record(name, start);
+  }
+};
+
+// clang-format off
+struct DVC_INFO { NvU32 _{sizeof(DVC_INFO) | 0x10000}; NvU32 cur; NvU32 min; NvU32 max; };  // clang-format on
+
+/** driver surface behind `DVC` (implemented by NvAPI and by the in-process simulator) */
+struct Backend {
+  virtual ~Backend() = default;
+
+  /** @returns number of detected connected displays */
+  virtual Result<std::size_t> display_count() = 0;
+
+  /** @returns 1-based index of primary display */
+  virtual Result<std::size_t> primary_display() = 0;
+
+  /** @returns cheap hash of the display layout that changes whenever a full re-enumeration is needed */
+  virtual std::uint64_t topology_fingerprint() = 0;
+
+  virtual NvAPI_Status enum_display_handle(std::size_t display, NvDisplayHandle* handle) = 0;
+  virtual NvAPI_Status get_dvc_info(NvDisplayHandle handle, DVC_INFO* info) = 0;
+  virtual NvAPI_Status set_dvc_level(NvDisplayHandle handle, NvU32 value) = 0;
+};
+
+/** @returns FNV-1a hash of `values` */
+static std::uint64_t fingerprint(const std::initializer_list<std::uint64_t> values) noexcept {
+  std::uint64_t hash = 0xcbf29ce484222325;
+  for (const std::uint64_t value : values) {
+    for (int byte = 0; byte < 8; ++byte) hash = (hash ^ ((value >> (byte * 8)) & 0xff)) * 0x100000001b3;
+  }
+
+  return hash;
+}
+
+#ifdef _WIN32
 /** @returns number of detected connected displays */
-static std::size_t get_display_count() {
-  static int count = NULL;
-  if (!count) EnumDisplayMonitors(NULL, NULL, [](HMONITOR__*, HDC__*, tagRECT*, long long) { return ++count; }, NULL);
-  if (!count) return reject("Unable to display count");
-  return count;
+static Result<std::size_t> get_display_count() {
+  const Span span{"EnumDisplayMonitors"};
+  int count = NULL;
+  const auto counter = [](HMONITOR__*, HDC__*, tagRECT*, long long data) { return ++*reinterpret_cast<int*>(data); };
+  EnumDisplayMonitors(NULL, NULL, counter, reinterpret_cast<long long>(&count));
+  if (!count) return fail("Unable to display count");
+  return static_cast<std::size_t>(count);
 }
 
 /** @returns 1-based index of primary display */
-static std::size_t get_primary_display() {
+static Result<std::size_t> get_primary_display() {
   DISPLAY_DEVICE dd{};
   dd.cb = sizeof(dd);
   for (DWORD i = 0; EnumDisplayDevices(NULL, i, &dd, NULL); ++i) {
-    if (dd.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE) return i + 1;
+    if (dd.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE) return std::size_t{i + 1};
     ZeroMemory(&dd, sizeof(dd));
     dd.cb = sizeof(dd);
   }
 
-  return reject("Unable to get primary display");
+  return fail("Unable to get primary display");
 }
 
-struct NVAPI {
+struct NVAPI final : Backend {
   typedef NvAPI_Status (*NvAPI_Initialize_t)();
   static constexpr std::intptr_t INITIALIZE = 0x0150e828;
 
+  typedef NvAPI_Status (*NvAPI_EnumNvidiaDisplayHandle_t)(std::size_t display, NvDisplayHandle* handle);
+  static constexpr std::intptr_t ENUM_NVIDIA_DISPLAY_HANDLE = 0x9abdd40d;
+
+  typedef NvAPI_Status (*NvAPI_GetDVCInfo_t)(NvDisplayHandle handle, std::size_t display, DVC_INFO* info);
+  static constexpr std::intptr_t GET_DVC_INFO = 0x4085de45;  // undocumented
+
+  typedef NvAPI_Status (*NvAPI_SetDVCLevel_t)(NvDisplayHandle handle, std::size_t display, NvU32 value);
+  static constexpr std::intptr_t SET_DVC_LEVEL = 0x172409b4;  // undocumented
+
   typedef std::intptr_t (*NvAPI_QueryInterface_t)(...);
-  NvAPI_QueryInterface_t ${nullptr};
+
+  /** entry points resolved through `nvapi_QueryInterface`, all validated on construction */
+  struct Dispatch {
+    NvAPI_Initialize_t initialize{nullptr};
+    NvAPI_EnumNvidiaDisplayHandle_t enum_nvidia_display_handle{nullptr};
+    NvAPI_GetDVCInfo_t get_dvc_info{nullptr};
+    NvAPI_SetDVCLevel_t set_dvc_level{nullptr};
+  };
 
   const HMODULE instance{nullptr};
+  Dispatch nvapi{};
   ~NVAPI() { instance&& FreeLibrary(instance); }
-  NVAPI() : instance(LoadLibrary("nvapi64.dll")) {
-    if (!instance) reject("Failed to load nvapi64.dll");
-    $ = (NvAPI_QueryInterface_t)GetProcAddress(instance, "nvapi_QueryInterface");
-    if (!$) reject("Failed to load `nvapi_QueryInterface`");
-    static const NvAPI_Initialize_t& init{(NvAPI_Initialize_t)($)(NVAPI::INITIALIZE)};
-    if (!init || (*init)() != NVAPI_OK) reject("Failed to initialize NvAPI");
+
+  /** @returns initialized driver, or why nvapi64.dll or any of its entry points could not be loaded */
+  static Result<std::unique_ptr<NVAPI>> open() {
+    std::unique_ptr<NVAPI> driver{new NVAPI{load()}};
+    if (!driver->instance) return fail("Failed to load nvapi64.dll");
+    const NvAPI_QueryInterface_t query{(NvAPI_QueryInterface_t)GetProcAddress(driver->instance, "nvapi_QueryInterface")};
+    if (!query) return fail("Failed to load `nvapi_QueryInterface`");
+
+    std::string missing;
+    const auto resolve = [&]<typename Entry>(Entry& entry, const std::intptr_t id, const char* name) {
+      entry = (Entry)(query)(id);
+      if (!entry) missing += (missing.empty() ? "Failed to load `" : ", `") + std::string{name} + '`';
+    };
+
+    Dispatch& entries = driver->nvapi;
+    resolve(entries.initialize, NVAPI::INITIALIZE, "nvapi_Initialize");
+    resolve(entries.enum_nvidia_display_handle, NVAPI::ENUM_NVIDIA_DISPLAY_HANDLE, "nvapi_EnumNvidiaDisplayHandle");
+    resolve(entries.get_dvc_info, NVAPI::GET_DVC_INFO, "nvapi_GetDVCInfo");
+    resolve(entries.set_dvc_level, NVAPI::SET_DVC_LEVEL, "nvapi_SetDVCLevel");
+    if (!missing.empty()) return fail(std::move(missing));
+
+    const Span span{"NvAPI_Initialize"};
+    if (const NvAPI_Status status = (*entries.initialize)(); status != NVAPI_OK) {
+      return fail("Failed to initialize NvAPI", status);
+    }
+
+    return driver;
+  }
+
+  Result<std::size_t> display_count() override { return get_display_count(); }
+
+  Result<std::size_t> primary_display() override { return get_primary_display(); }
+
+  std::uint64_t topology_fingerprint() override {
+    std::uint64_t metrics[7]{};
+    constexpr int METRICS[7]{
+      SM_CMONITORS, SM_XVIRTUALSCREEN, SM_YVIRTUALSCREEN, SM_CXVIRTUALSCREEN, SM_CYVIRTUALSCREEN, SM_CXSCREEN, SM_CYSCREEN,
+    };
+
+    std::transform(std::begin(METRICS), std::end(METRICS), metrics, [](const int metric) {
+      return static_cast<std::uint64_t>(GetSystemMetrics(metric));
+    });
+
+    return fingerprint({metrics[0], metrics[1], metrics[2], metrics[3], metrics[4], metrics[5], metrics[6]});
+  }
+
+  NvAPI_Status enum_display_handle(const std::size_t display, NvDisplayHandle* handle) override {
+    return (*nvapi.enum_nvidia_display_handle)(display, handle);
+  }
+
+  NvAPI_Status get_dvc_info(NvDisplayHandle handle, DVC_INFO* info) override {
+    return (*nvapi.get_dvc_info)(handle, NULL, info);
+  }
+
+  NvAPI_Status set_dvc_level(NvDisplayHandle handle, const NvU32 value) override {
+    return (*nvapi.set_dvc_level)(handle, NULL, value);
+  }
+
+ private:
+  explicit NVAPI(const HMODULE module) : instance(module) {}
+
+  static HMODULE load() {
+    const Span span{"LoadLibrary"};
+    return LoadLibrary("nvapi64.dll");
   }
 };
+#endif
+
+/**
+ * In-process stand-in for the NvAPI driver, so the hot path can be profiled without an NVIDIA card.
+ * Configured through `NVDV_SIM_*` environment variables; every driver call sleeps for `latency`
+ * (plus `stall` with probability `stall_rate`) and then fails with probability `failure_rate`.
+ */
+struct Simulator final : Backend {
+  struct Config {
+    std::size_t displays{env_or<std::size_t>("NVDV_SIM_DISPLAYS", 1)};
+    std::size_t primary{env_or<std::size_t>("NVDV_SIM_PRIMARY", 1)};
+    NvU32 min{env_or<NvU32>("NVDV_SIM_MIN", 0)};
+    NvU32 max{env_or<NvU32>("NVDV_SIM_MAX", 63)};
+    NvU32 level{env_or<NvU32>("NVDV_SIM_LEVEL", min)};
+    std::chrono::microseconds latency{env_or<std::int64_t>("NVDV_SIM_LATENCY_US", 0)};
+    double failure_rate{env_or<double>("NVDV_SIM_FAILURE_RATE", 0.0)};
+    std::chrono::milliseconds stall{env_or<std::int64_t>("NVDV_SIM_STALL_MS", 0)};  // a busy driver hanging a call
+    double stall_rate{env_or<double>("NVDV_SIM_STALL_RATE", 0.0)};
+    std::uint32_t seed{env_or<std::uint32_t>("NVDV_SIM_SEED", std::random_device{}())};
+    std::uint64_t generation{env_or<std::uint64_t>("NVDV_SIM_TOPOLOGY", 0)};  // bump to fake a layout change
+    std::string state{CLI::detail::get_environment_value("NVDV_SIM_STATE")};  // file sharing levels across processes
+  };
+
+  const Config config;
+  Simulator(const Config& settings) : config(settings), levels(settings.displays, settings.level), rng(settings.seed) {}
+
+  Result<std::size_t> display_count() override {
+    if (!config.displays) return fail("Unable to display count");
+    return config.displays;
+  }
+
+  Result<std::size_t> primary_display() override {
+    if (config.primary < 1 || config.primary > config.displays) return fail("Unable to get primary display");
+    return config.primary;
+  }
+
+  std::uint64_t topology_fingerprint() override {
+    return fingerprint({config.displays, config.primary, config.min, config.max, config.generation});
+  }
+
+  NvAPI_Status enum_display_handle(const std::size_t display, NvDisplayHandle* handle) override {
+    if (!call()) return NVAPI_ERROR;
+    if (display >= levels.size()) return NVAPI_END_ENUMERATION;
+    *handle = reinterpret_cast<NvDisplayHandle>(display + 1);
+    return NVAPI_OK;
+  }
+
+  NvAPI_Status get_dvc_info(NvDisplayHandle handle, DVC_INFO* info) override {
+    if (!call()) return NVAPI_ERROR;
+    const std::lock_guard lock{mutex};
+    load();
+    NvU32* level = find(handle);
+    if (!level) return NVAPI_INVALID_ARGUMENT;
+    *info = DVC_INFO{.cur = *level, .min = config.min, .max = config.max};
+    return NVAPI_OK;
+  }
+
+  NvAPI_Status set_dvc_level(NvDisplayHandle handle, const NvU32 value) override {
+    if (!call()) return NVAPI_ERROR;
+    const std::lock_guard lock{mutex};
+    load();
+    NvU32* level = find(handle);
+    if (!level || value < config.min || value > config.max) return NVAPI_INVALID_ARGUMENT;
+    *level = value;
+    save();
+    return NVAPI_OK;
+  }
 
-struct DVC {
  private:
-  // clang-format off
-  struct DVC_INFO { const NvU32 _{sizeof(DVC_INFO) | 0x10000}; const NvU32 cur; const NvU32 min; const NvU32 max; };  // clang-format on
+  std::vector<NvU32> levels;
+  std::mt19937 rng;
+  std::mutex mutex;
 
-  typedef NvAPI_Status (*NvAPI_EnumNvidiaDisplayHandle_t)(std::size_t display, NvDisplayHandle* handle);
-  static constexpr std::intptr_t ENUM_NVIDIA_DISPLAY_HANDLE = 0x9abdd40d;
+  NvU32* find(NvDisplayHandle handle) noexcept {
+    const std::size_t index = reinterpret_cast<std::uintptr_t>(handle) - 1;
+    return index < levels.size() ? &levels[index] : nullptr;
+  }
 
-  typedef NvAPI_Status (*NvAPI_GetDVCInfo_t)(NvDisplayHandle handle, std::size_t display, DVC_INFO* info);
-  static constexpr std::intptr_t GET_DVC_INFO = 0x4085de45;  // undocumented
+  /** picks up levels written by other processes sharing `config.state` */
+  void load() {
+    if (config.state.empty()) return;
+    std::ifstream file{config.state};
+    for (NvU32& level : levels) {
+      if (!(file >> level)) break;
+    }
+  }
 
-  typedef NvAPI_Status (*NvAPI_SetDVCLevel_t)(NvDisplayHandle handle, std::size_t display, NvU32 value);
-  static constexpr std::intptr_t SET_DVC_LEVEL = 0x172409b4;  // undocumented
+  void save() const {
+    if (config.state.empty()) return;
+    std::ofstream file{config.state, std::ios::trunc};
+    for (const NvU32 level : levels) file << level << '\n';
+  }
+
+  /** @returns false if this call was picked to fail (after waiting out the configured latency and stalls) */
+  bool call() {
+    if (config.latency.count() > 0) std::this_thread::sleep_for(config.latency);
+    if (config.stall_rate > 0.0 && pick(config.stall_rate)) std::this_thread::sleep_for(config.stall);
+    return config.failure_rate <= 0.0 || !pick(config.failure_rate);
+  }
+
+  bool pick(const double probability) {
+    const std::lock_guard lock{mutex};
+    return std::bernoulli_distribution{probability}(rng);
+  }
+};
+
+/** @returns NvAPI driver (the simulator when `NVDV_SIMULATE` is set), or why it could not be loaded */
+static Result<std::unique_ptr<Backend>> make_backend() {
+#ifdef _WIN32
+  if (CLI::detail::get_environment_value("NVDV_SIMULATE").empty()) {
+    Result<std::unique_ptr<NVAPI>> driver = NVAPI::open();
+    if (!driver) return std::move(driver.error());
+    return std::unique_ptr<Backend>{std::move(*driver)};
+  }
+#endif
+  return std::unique_ptr<Backend>{std::make_unique<Simulator>(Simulator::Config{})};
+}
 
+/** outcome of one driver call, with the outputs it filled in (owned by the call, not the caller) */
+struct DriverCall {
+  NvAPI_Status status = NVAPI_ERROR;
+  bool late = false;  // missed its deadline on every attempt, so `status` was never received
   NvDisplayHandle handle{nullptr};
-  NvAPI_SetDVCLevel_t nvapi_SetDVCLevel{nullptr};
+  DVC_INFO info{};
+};
 
+/**
+ * Runs driver calls under a deadline (`--deadline` per call, counted from when the call starts running, and `--budget`
+ * per command). Each calling thread gets a dedicated driver thread, so concurrent displays never queue behind each
+ * other. A call missing its deadline is counted late and abandoned to its driver thread, which a fresh one replaces;
+ * with `--retries` it is reissued after an exponential backoff while the budget allows.
+ * Without a deadline or budget, calls run inline on the caller's thread.
+ */
+class Watchdog : public std::enable_shared_from_this<Watchdog> {
  public:
-  DVC_INFO info{};
-  const std::size_t display;
-  DVC(const NVAPI& nvapi, const std::size_t n) : display(n) {
-    static const NvAPI_GetDVCInfo_t& get_dvc_info{(NvAPI_GetDVCInfo_t)(*nvapi.$)(DVC::GET_DVC_INFO)};
-    static const NvAPI_EnumNvidiaDisplayHandle_t& enum_display_handle{
-      (NvAPI_EnumNvidiaDisplayHandle_t)(*nvapi.$)(DVC::ENUM_NVIDIA_DISPLAY_HANDLE)
+  using clock = std::chrono::steady_clock;
+  static inline std::size_t deadline_ms = 0;  // per attempt (none when 0)
+  static inline std::size_t budget_ms = 0;  // for every call of the command since `start` (none when 0)
+  static inline std::size_t retries = 0;
+  static inline std::size_t backoff_ms = 10;  // before the first retry, doubling for each further one
+  static inline clock::time_point start = clock::now();
+  static inline std::atomic<std::size_t> late = 0;
+  static inline std::atomic<std::size_t> retried = 0;
+  static inline std::atomic<std::size_t> abandoned = 0;  // driver threads left behind in a hung call
+
+  /** @returns result of `call(outputs)` (the driver status), or a `late` one */
+  template <typename Call>
+  static DriverCall run(Call call) {
+    if (!deadline_ms && !budget_ms) {
+      DriverCall result;
+      result.status = call(result);
+      return result;
+    }
+
+    return local().supervise(std::move(call));
+  }
+
+  /** @returns late/retried/abandoned counters as a line (empty while no call was late) */
+  static std::string counters() {
+    if (!late) return {};
+    char line[128];
+    const char* const format = "watchdog     %zu late call(s), %zu retried, %zu thread(s) abandoned\n";
+    const int size = std::snprintf(line, sizeof(line), format, late.load(), retried.load(), abandoned.load());
+    return {line, static_cast<std::size_t>(size)};
+  }
+
+ private:
+  struct Job {
+    std::function<NvAPI_Status(DriverCall&)> call;
+    DriverCall result;
+    clock::time_point started{};  // by the driver thread (not yet when default)
+    bool done = false;
+  };
+
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::condition_variable progressed;  // a job started or finished
+  std::shared_ptr<Job> pending;  // issued, not picked up yet
+  std::size_t generation = 0;  // of the current driver thread (none yet when 0)
+
+  /** @returns the calling thread's watchdog, shared with its driver threads (an abandoned one may outlive both) */
+  static Watchdog& local() {
+    struct Owner {
+      const std::shared_ptr<Watchdog> watchdog = std::make_shared<Watchdog>();
+      ~Owner() { watchdog->retire(); }
     };
 
-    if (!get_dvc_info) reject("Failed to load `nvapi_GetDVCInfo`");
-    if (!enum_display_handle) reject("Failed to load `nvapi_EnumNvidiaDisplayHandle`");
-    if ((*enum_display_handle)(display - 1, &handle) != NVAPI_OK) reject("Failed to get display handle");
-    if ((*get_dvc_info)(handle, NULL, &info) != NVAPI_OK) reject("Failed to get DVC info");
-    if (!(nvapi_SetDVCLevel = (NvAPI_SetDVCLevel_t)(*nvapi.$)(DVC::SET_DVC_LEVEL))) {
-      reject("Failed to load `nvapi_SetDVCLevel`");
+    static thread_local Owner owner;
+    return *owner.watchdog;
+  }
+
+  DriverCall supervise(const std::function<NvAPI_Status(DriverCall&)>& call) {
+    using std::chrono::milliseconds;
+    const clock::time_point end = budget_ms ? start + milliseconds{budget_ms} : clock::time_point::max();
+    milliseconds backoff{backoff_ms};
+    for (std::size_t attempt = 0; clock::now() < end; ++attempt) {
+      const std::shared_ptr<Job> job = std::make_shared<Job>(Job{call, {}, {}, false});
+      {
+        std::unique_lock lock{mutex};
+        if (!generation) spawn();
+        pending = job;
+        ready.notify_all();
+        const auto deadline = [&] {
+          if (!deadline_ms || job->started == clock::time_point{}) return end;
+          return std::min(job->started + milliseconds{deadline_ms}, end);
+        };
+
+        while (!job->done && clock::now() < deadline()) progressed.wait_until(lock, deadline());
+        if (job->done) return job->result;
+        if (pending == job) pending.reset();  // never started
+        else spawn(), ++abandoned;  // the driver thread hangs in this very call, a fresh one serves the next
+        ++late;
+      }
+
+      if (attempt == retries || clock::now() + backoff >= end) break;
+      std::this_thread::sleep_for(backoff);
+      backoff *= 2, ++retried;
+    }
+
+    DriverCall missed;
+    missed.late = true;
+    return missed;
+  }
+
+  /** starts a driver thread (a previous one exits once its current call returns) */
+  void spawn() {
+    std::thread(&Watchdog::drive, shared_from_this(), ++generation).detach();
+    ready.notify_all();
+  }
+
+  /** lets the idle driver thread exit once the calling thread is gone */
+  void retire() {
+    const std::lock_guard lock{mutex};
+    ++generation;
+    ready.notify_all();
+  }
+
+  void drive(const std::size_t own) {
+    std::unique_lock lock{mutex};
+    for (;;) {
+      ready.wait(lock, [&] { return pending || generation != own; });
+      if (generation != own) return;
+      const std::shared_ptr<Job> job = std::exchange(pending, nullptr);
+      job->started = clock::now();
+      progressed.notify_all();
+      lock.unlock();
+      DriverCall result;
+      result.status = job->call(result);
+      lock.lock();
+      job->result = result, job->done = true;
+      progressed.notify_all();
     }
   }
+};
+
+struct DVC {
+ private:
+  using clock = std::chrono::steady_clock;
+  Backend* backend{nullptr};
+  NvDisplayHandle handle{nullptr};
+  clock::time_point read_at{};
+  std::array<NvU32, 101> raw_levels{};  // by percentage, for the `tabulated` min/max
+  std::pair<NvU32, NvU32> tabulated{1, 0};
+
+ public:
+  static inline std::size_t verify_ms = 0;  // re-read levels older than this before trusting them (never when 0)
+  DVC_INFO info{};
+  bool current = false;  // whether `info.cur` is the driver's level (false when built from a cached range)
+  const std::size_t display;
+  std::size_t written = 0;
+  std::size_t avoided = 0;  // writes skipped because the level was already applied
+  std::size_t verified = 0;
+  std::size_t stale = 0;  // verify reads that found a level changed behind our back
+
+  /** @returns controller for display `n`, with its level and range read from the driver */
+  static Result<DVC> open(Backend& driver, const std::size_t n) {
+    DVC dvc{driver, n};
+    if (Result<> found = dvc.enum_handle(); !found) return std::move(found.error());
+    if (Result<> read = dvc.refresh(); !read) return std::move(read.error());
+    return dvc;
+  }
+
+  /** @returns write-only controller built from a cached min/max `range`, skipping `GetDVCInfo` */
+  static Result<DVC> open(Backend& driver, const std::size_t n, const std::pair<NvU32, NvU32> range) {
+    DVC dvc{driver, n};
+    if (Result<> found = dvc.enum_handle(); !found) return std::move(found.error());
+    dvc.info.cur = dvc.info.min = range.first;
+    dvc.info.max = range.second;
+    dvc.tabulate();
+    return dvc;
+  }
 
+  /** re-reads current level and range from the driver (resident controllers may be stale) */
+  Result<> refresh() {
+    const Span span{"GetDVCInfo"};
+    const DriverCall call = Watchdog::run([driver = backend, display = handle](DriverCall& out) {
+      return driver->get_dvc_info(display, &out.info);
+    });
+
+    if (call.late) return fail("GetDVCInfo missed its deadline");
+    else if (call.status != NVAPI_OK) return fail("Failed to get DVC info", call.status);
+    info = call.info, current = true, read_at = clock::now();
+    tabulate();
+    return {};
+  }
+
+  /** @returns `value` as a percentage of the range, in integer arithmetic rounding like `rounded_percent` */
   NvU32 raw_to_percent(const NvU32 value) const noexcept {
-    const double total = static_cast<double>(info.max - info.min);
-    const double decimal = static_cast<double>(value - info.min) / total;
-    return static_cast<NvU32>(std::round(decimal * 100.0));
+    const std::uint32_t offset = static_cast<std::uint32_t>(value - info.min);
+    const std::uint32_t total = static_cast<std::uint32_t>(info.max - info.min);
+    if (!total || offset > total || total > 0xffffff) return rounded_percent(value, info.min, info.max);
+    const std::uint32_t percent = 200 * offset / (2 * total), remainder = 200 * offset % (2 * total);
+    if (remainder == total) return rounded_percent(value, info.min, info.max);  // exact half
+    return percent + (remainder > total);
   }
 
   NvU32 percent_to_raw(const NvU32 value) const noexcept {
-    const double total = static_cast<double>(info.max - info.min);
-    const double decimal = static_cast<double>(value) / 100.0;
-    return static_cast<NvU32>(std::round((decimal * total) + info.min));
+    return value < raw_levels.size() ? raw_levels[value] : rounded_raw(value, info.min, info.max);
+  }
+
+  /** converts `count` percentages to raw levels through the lookup table (percentages above 100 clamp) */
+  void percent_to_raw(const NvU32* percents, NvU32* values, const std::size_t count) const noexcept {
+    for (std::size_t i = 0; i < count; ++i) values[i] = raw_levels[std::min<NvU32>(percents[i], 100)];
+  }
+
+  /**
+   * Reference floating point conversions. Exact halves round whichever way the double arithmetic lands, so the integer
+   * and table based conversions above defer to these wherever that matters.
+   */
+  static NvU32 rounded_percent(const NvU32 value, const NvU32 min, const NvU32 max) noexcept {
+    const double total = static_cast<double>(max - min);
+    const double decimal = static_cast<double>(value - min) / total;
+    return static_cast<NvU32>(std::round(decimal * 100.0));
+  }
+
+  static NvU32 rounded_raw(const NvU32 percent, const NvU32 min, const NvU32 max) noexcept {
+    const double total = static_cast<double>(max - min);
+    const double decimal = static_cast<double>(percent) / 100.0;
+    return static_cast<NvU32>(std::round((decimal * total) + min));
   }
 
-  NvAPI_Status set_raw(const NvU32 value) const {
-    if (value < info.min || value > info.max) return reject("Value out of range");
-    else if (value != info.cur && (*nvapi_SetDVCLevel)(handle, NULL, value) != NVAPI_OK) {
-      return reject("Failed to set the digital vibrance");
+  /**
+   * Writes raw `value` unless it is the last level read or applied. With `--verify`, a level not read back from the
+   * driver within that many ms is re-read before a write is skipped, in case something else changed it.
+   */
+  Result<> set_raw(const NvU32 value) {
+    if (current && value == info.cur && verify_ms && clock::now() - read_at > std::chrono::milliseconds{verify_ms}) {
+      const NvU32 tracked = info.cur;
+      if (Result<> read = refresh(); !read) return read;
+      ++verified;
+      if (info.cur != tracked) ++stale;
     }
 
-    return NVAPI_OK;
+    if (value < info.min || value > info.max) return fail("Value out of range", NVAPI_INVALID_ARGUMENT);
+    else if (current && value == info.cur) return ++avoided, Result<>{};
+    else if (const DriverCall call = set_level(value); call.late) return fail("SetDVCLevel missed its deadline");
+    else if (call.status != NVAPI_OK) {
+      if (current) return fail("Failed to set the digital vibrance", call.status);
+      if (Result<> read = refresh(); !read) return read;  // the cached range may be outdated, retry once against it
+      return set_raw(value);
+    }
+
+    info.cur = value, current = true, ++written;
+    return {};
   }
 
-  NvAPI_Status set(const NvU32 percentage) const {
+  Result<> set(const NvU32 percentage) {
     const NvU32 value = percent_to_raw(percentage);
     return set_raw(value);
   }
+
+ private:
+  DVC(Backend& driver, const std::size_t n) : backend(&driver), display(n) {}
+
+  Result<> enum_handle() {
+    const Span span{"EnumNvidiaDisplayHandle"};
+    const DriverCall call = Watchdog::run([driver = backend, index = display - 1](DriverCall& out) {
+      return driver->enum_display_handle(index, &out.handle);
+    });
+
+    if (call.late) return fail("EnumNvidiaDisplayHandle missed its deadline");
+    else if (call.status != NVAPI_OK) return fail("Failed to get display handle", call.status);
+    handle = call.handle;
+    return {};
+  }
+
+  /** rebuilds the percent to raw table if the range changed */
+  void tabulate() noexcept {
+    if (tabulated == std::pair{info.min, info.max}) return;
+    tabulated = {info.min, info.max};
+    const std::uint64_t total = info.max - info.min;
+    for (NvU32 percent = 0; percent < raw_levels.size(); ++percent) {
+      const std::uint64_t scaled = percent * total, remainder = scaled % 100;  // round(percent * total / 100)
+      if (remainder == 50 || info.max < info.min) raw_levels[percent] = rounded_raw(percent, info.min, info.max);
+      else raw_levels[percent] = info.min + static_cast<NvU32>(scaled / 100 + (remainder > 50));
+    }
+  }
+
+  DriverCall set_level(const NvU32 value) {
+    const Span span{"SetDVCLevel"};
+    return Watchdog::run([driver = backend, display = handle, value](DriverCall&) {
+      return driver->set_dvc_level(display, value);
+    });
+  }
 };
 
+/** requested level, as a percentage unless given as `raw:<value>` */
+struct Level {
+  NvU32 value = 0;
+  bool raw = false;
+
+  NvU32 to_raw(const DVC& dvc) const noexcept { return raw ? value : dvc.percent_to_raw(value); }
+};
+
+/** `play` timeline entry: `level` for `display` (0 for every display) at `ms` after the start */
+struct Keyframe {
+  std::size_t ms = 0;
+  std::size_t display = 0;
+  Level level;
+};
+
+/** `info` output formats */
+enum class Format { text, json, csv, tsv, binary };
+
+/** layout of `--format binary` records: version, display, primary, current, min, max (bumped on any change) */
+static constexpr std::uint32_t BINARY_VERSION = 1;
+
+/** per-display commands (stateless, reading their arguments from the app context) */
+namespace commands {
+  struct Info {
+    Result<> operator()(DVC& dvc) const;
+  };
+
+  struct Toggle {
+    Result<> operator()(DVC& dvc) const;
+  };
+
+  struct Disable {
+    Result<> operator()(DVC& dvc) const;
+  };
+
+  struct Enable {
+    Result<> operator()(DVC& dvc) const;
+  };
+
+  struct Set {
+    Result<> operator()(DVC& dvc) const;
+  };
+
+  struct SetTargets {
+    Result<> operator()(DVC& dvc) const;
+  };
+
+  struct Apply {
+    Result<> operator()(DVC& dvc) const;
+  };
+}  // namespace commands
+
+/** parsed command, dispatched without heap allocation or type erasure */
+using Command = std::variant<std::monostate, commands::Info, commands::Toggle, commands::Disable, commands::Enable,
+  commands::Set, commands::SetTargets, commands::Apply>;
+
 // app context
 namespace nvdv {
+#ifdef _WIN32
   static HANDLE handle{nullptr};
-  static const std::size_t display_count = get_display_count();
-  static const std::size_t primary_display = get_primary_display();
-  static const std::unique_ptr<NVAPI>& nvapi{std::make_unique<NVAPI>()};
-  static std::function<NvAPI_Status(const DVC&)> run_command{nullptr};
-  static std::vector<std::size_t> displays{nvdv::primary_display};
+#else
+  static int handle{-1};
+#endif
+  static Command command;
+  static std::vector<std::size_t> displays;  // primary display only when empty
   static std::vector<DVC> controllers;
-  static NvU32 value_to_set = NULL;
+  static std::vector<DVC*> selected;  // controllers the command runs on, kept to reuse its capacity across requests
+  static std::vector<std::pair<std::size_t, Failure>> failures;  // by display, reported once the command finished
+  static std::function<std::string()> report{nullptr};  // `--timings` summary line, once the command finished
+  static std::size_t succeeded = 0;  // displays the command ran on without failure
+  static std::map<std::size_t, Level> targets;  // display 0 matches any display without its own target
+  static std::vector<Keyframe> keyframes;  // in file order
+  static std::vector<std::string> values;
+  static std::string file;
+  static std::string events;  // scripted focus changes for `profile`
+  static std::string output;
+  static thread_local std::string* sink = &output;  // per-display buffer while running on workers
+  static std::atomic<std::size_t> drift = 0;
+  static std::size_t jobs = 1;
+  static Format format = Format::text;
+  static bool watch = false;
+  static std::size_t poll_min_ms = 50;
+  static std::size_t poll_max_ms = 1000;
+  static std::size_t debounce_ms = 250;
+  static std::size_t ramp_ms = 0;
+  static std::chrono::steady_clock::time_point ramp_start;  // shared by the ramps of one command
+  static double fps = 60.0;
+  static double max_rate = 0.0;  // driver writes per second and display (unlimited when 0)
+  static NvU32 value_to_set = 0;
   static bool raw = false;
   static bool all = false;
+  static bool dry_run = false;
+  static bool serving = false;
+  static bool beside_server = false;  // running a read-only command the server handed back, without the instance lock
+  static bool read_stdin = false;  // `--stdin`
+  static bool timings = false;
+  static bool rescan = false;
+  static bool cached_ranges = false;
+  static bool write_only = false;  // command never reads `info.cur`
+  static std::array<std::pair<const char*, double>, 8> phases;  // fixed, so recording them never allocates
+  static std::size_t phase_count = 0;
+  static std::chrono::steady_clock::time_point phase_start = std::chrono::steady_clock::now();
 }  // namespace nvdv
 
-static NvAPI_Status init_dvc() {
-  if (nvdv::all) {
-    std::size_t n = 0;
-    nvdv::displays.clear();
-    nvdv::displays.resize(nvdv::display_count);
-    std::generate(nvdv::displays.begin(), nvdv::displays.end(), [&] { return ++n; });
-  }
+/** runs the parsed command on `dvc` */
+static Result<> run_command(DVC& dvc) {
+  return std::visit([&](const auto& command) {
+    if constexpr (std::is_same_v<decltype(command), const std::monostate&>) return Result<>{};
+    else return command(dvc);
+  }, nvdv::command);
+}
 
-  for (const std::size_t n : nvdv::displays) {
-    if (n < 1 || n > nvdv::display_count) return reject("Invalid display number provided");
-    nvdv::controllers.emplace_back(*nvdv::nvapi.get(), n);
+/** records the time spent since the previous startup phase ended */
+static void mark_phase(const char* phase) {
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (nvdv::phase_count < nvdv::phases.size()) {
+    nvdv::phases[nvdv::phase_count++] = {phase, std::chrono::duration<double, std::milli>(now - nvdv::phase_start).count()};
   }
 
-  return nvdv::controllers.empty() ? reject("Unable to initialize dvc(s) for display(s)") : NVAPI_OK;
+  nvdv::phase_start = now;
 }
 
-static void cleanup() {
-  ReleaseMutex(nvdv::handle);
-  CloseHandle(nvdv::handle);
-}
+/**
+ * Display layout persisted between runs, so repeat invocations can skip monitor and display device enumeration.
+ * NvAPI display handles are only valid within one process, so only their DVC ranges are cached.
+ */
+struct Topology {
+  std::uint64_t fingerprint = 0;
+  std::size_t display_count = 0;
+  std::size_t primary_display = 0;
+  std::vector<std::pair<NvU32, NvU32>> ranges;  // DVC min/max per display ({0, 0} until first seen)
 
-static void ensure_single_instance() {
-  nvdv::handle = CreateMutex(NULL, TRUE, APP_NAME);
-  if (!nvdv::handle) reject("Unable to create mutex for nvdv handle");
-  if (GetLastError() == ERROR_ALREADY_EXISTS) CloseHandle(nvdv::handle), std::exit(0);
-  for (const int sig : ABORT_SIGNALS) signal(sig, [](const int code) { cleanup(), std::exit(code); });
-  std::atexit(cleanup);
-}
+  /** @returns snapshot location (`NVDV_TOPOLOGY_CACHE` or the temp directory) */
+  static std::filesystem::path path() {
+    const std::string custom = CLI::detail::get_environment_value("NVDV_TOPOLOGY_CACHE");
+    if (!custom.empty()) return custom;
+    std::error_code error;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+    return error ? std::filesystem::path{} : directory / "nvdv-topology";
+  }
 
-int wmain(int argc, wchar_t* argv[]) {
-  ensure_single_instance();
-  static CLI::App app{APP_NAME};
-  app.set_version_flag("-v,--version", APP_VERSION);
-  app.add_option("-d,--display", nvdv::displays, "Specify other display number (handles only primary by default)");
-  app.add_flag("-a,--all", nvdv::all, "Handle all available displays (overrides `--display`)");
-  static const std::function<NvAPI_Status(const DVC&)>& handle_set{[](const DVC& dvc) {
-    return nvdv::raw ? dvc.set_raw(nvdv::value_to_set) : dvc.set(nvdv::value_to_set);
-  }};
-
-  app.add_subcommand("info", "output current digital vibrance control info")->callback([] {
-    nvdv::run_command = [](const DVC& dvc) {
-      const auto& [_, cur, min, max]{dvc.info};
-      printf("Display %zu%c\n", dvc.display, dvc.display == nvdv::primary_display ? '*' : '\0');
-      printf("Current DV: %lu%c (%lu%%)\n", cur, cur < 10 ? ' ' : '\0', dvc.raw_to_percent(cur));
-      printf("Minimum DV: %lu  (0%%)\n", min);
-      printf("Maximum DV: %lu (100%%)\n\n", max);
-      return NVAPI_OK;
-    };
-  });
+  /** @returns snapshot stored by a previous run, or nullopt if missing or unreadable */
+  static std::optional<Topology> load() {
+    Topology topology;
+    std::ifstream file{path()};
+    std::string magic;
+    if (!(file >> magic >> topology.fingerprint >> topology.display_count >> topology.primary_display)) return std::nullopt;
+    if (magic != "nvdv-topology-1" || !topology.display_count) return std::nullopt;
+    topology.ranges.resize(topology.display_count);
+    for (std::size_t display = 0; file >> display;) {
+      if (display < 1 || display > topology.display_count) return std::nullopt;
+      if (!(file >> topology.ranges[display - 1].first >> topology.ranges[display - 1].second)) return std::nullopt;
+    }
 
-  app.add_subcommand("toggle", "toggle current digital vibrance (between min and max)")->callback([] {
-    nvdv::run_command = [](const DVC& dvc) {
-      nvdv::value_to_set = dvc.info.cur > dvc.info.min ? dvc.info.min : dvc.info.max;
-      return nvdv::raw = true, handle_set(dvc);
-    };
-  });
+    return topology;
+  }
 
-  app.add_subcommand("disable", "disable current digital vibrance (set to min)")->callback([] {
-    nvdv::run_command = [](const DVC& dvc) {
-      nvdv::value_to_set = dvc.info.min;
-      return nvdv::raw = true, handle_set(dvc);
-    };
-  });
+  /** writes the snapshot (best effort, a failed write only costs the next run a re-enumeration) */
+  void save() const {
+    const std::filesystem::path target = path();
+    if (target.empty()) return;
+    std::filesystem::path temporary{target};
+    temporary += ".tmp";
+    {
+      std::ofstream file{temporary, std::ios::trunc};
+      file << "nvdv-topology-1 " << fingerprint << ' ' << display_count << ' ' << primary_display << '\n';
+      for (std::size_t i = 0; i < ranges.size(); ++i) {
+        if (ranges[i].second) file << i + 1 << ' ' << ranges[i].first << ' ' << ranges[i].second << '\n';
+      }
 
-  app.add_subcommand("enable", "enable current digital vibrance (set to max)")->callback([] {
-    nvdv::run_command = [](const DVC& dvc) {
-      nvdv::value_to_set = dvc.info.max;
-      return nvdv::raw = true, handle_set(dvc);
-    };
-  });
+      if (!file) return;
+    }
 
-  static CLI::App* set{app.add_subcommand("set", "set current digital vibrance level")};
-  set->add_flag("-r,--raw", nvdv::raw, "use raw values instead of percentage based scale");
-  set->add_option("value", nvdv::value_to_set, "value in range [0, 100] (unless `--raw` is given)")->required();
-  set->callback([] { nvdv::run_command = handle_set; });
+    std::error_code error;
+    std::filesystem::rename(temporary, target, error);
+  }
+};
+
+/** driver-backed part of the app context (built by `nvdv::connect` on first use, never for help/version/parse errors) */
+struct Context {
+  const std::unique_ptr<Backend> backend;
+  Topology topology;
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+
+  /** @returns context over the loaded driver, or why the driver or display topology could not be read */
+  static Result<std::unique_ptr<Context>> open() {
+    Result<std::unique_ptr<Backend>> driver = make_backend();
+    if (!driver) return std::move(driver.error());
+    std::unique_ptr<Context> context{new Context{std::move(*driver)}};
+    mark_phase("driver");
+    const std::optional<Topology> snapshot = nvdv::rescan ? std::nullopt : Topology::load();
+    if (snapshot && snapshot->fingerprint == context->backend->topology_fingerprint()) {
+      context->topology = *snapshot, ++context->hits;
+    } else if (Result<> enumerated = context->enumerate(); !enumerated) {
+      return std::move(enumerated.error());
+    }
+
+    mark_phase("displays");
+    return context;
+  }
+
+  /** re-enumerates displays if the topology fingerprint changed; @returns whether it did */
+  Result<bool> sync() {
+    if (topology.fingerprint == backend->topology_fingerprint()) return ++hits, false;
+    if (Result<> enumerated = enumerate(); !enumerated) return std::move(enumerated.error());
+    return true;
+  }
+
+  /** records DVC ranges read by `controllers`, persisting the snapshot if any were new */
+  void remember_ranges(const std::vector<DVC*>& controllers) {
+    bool changed = false;
+    for (const DVC* dvc : controllers) {
+      if (!dvc->current) continue;
+      std::pair<NvU32, NvU32>& range = topology.ranges[dvc->display - 1];
+      changed |= range != std::pair{dvc->info.min, dvc->info.max};
+      range = {dvc->info.min, dvc->info.max};
+    }
+
+    if (changed) topology.save();
+  }
+
+ private:
+  explicit Context(std::unique_ptr<Backend> driver) : backend(std::move(driver)) {}
+
+  /** reads the display layout, keeping the previous one (so the next `sync` retries) if it cannot be read */
+  Result<> enumerate() {
+    ++misses;
+    const std::uint64_t fingerprint = backend->topology_fingerprint();
+    Result<std::size_t> count = backend->display_count();
+    if (!count) return std::move(count.error());
+    Result<std::size_t> primary = backend->primary_display();
+    if (!primary) return std::move(primary.error());
+    topology.fingerprint = fingerprint;
+    topology.display_count = *count;
+    topology.primary_display = *primary;
+    topology.ranges.assign(topology.display_count, {});
+    topology.save();
+    return {};
+  }
+};
+
+namespace nvdv {
+  static std::unique_ptr<Context> connected;
+
+  /** builds the driver context unless it is already up; @returns why it could not be built */
+  static Result<> connect() {
+    if (connected) return {};
+    Result<std::unique_ptr<Context>> opened = Context::open();
+    if (!opened) return std::move(opened.error());
+    connected = std::move(*opened);
+    return {};
+  }
+
+  /** @returns driver context (`connect` must have succeeded) */
+  static Context& context() { return *connected; }
 
-  app.require_subcommand(1);
-  CLI11_PARSE(app, argc, argv);
-  if (init_dvc() == NVAPI_OK) std::for_each(nvdv::controllers.begin(), nvdv::controllers.end(), nvdv::run_command);
-  return 0;
+  static Backend& backend() { return *context().backend; }
+  static std::size_t display_count() { return context().topology.display_count; }
+  static std::size_t primary_display() { return context().topology.primary_display; }
+}  // namespace nvdv
+
+/** writes recorded startup phase timings and topology snapshot hits/misses to stderr */
+static void print_phases() {
+  double total = 0.0;
+  for (std::size_t i = 0; i < nvdv::phase_count; ++i) {
+    const auto& [phase, ms] = nvdv::phases[i];
+    std::fprintf(stderr, "%-12s %9.3f ms\n", phase, ms), total += ms;
+  }
+
+  std::fprintf(stderr, "%-12s %9.3f ms\n", "total", total);
+  if (!nvdv::connected) return;
+  std::fprintf(stderr, "topology     %zu hit(s), %zu miss(es)\n", nvdv::context().hits, nvdv::context().misses);
+}
+
+/** appends printf-style formatted text to the command output */
+template <typename... Args>
+static void print(const char* format, const Args... args) {
+  std::string& output = *nvdv::sink;
+  const std::size_t offset = output.size();
+  const std::size_t size = static_cast<std::size_t>(std::snprintf(nullptr, 0, format, args...));
+  output.resize(offset + size + 1);
+  std::snprintf(output.data() + offset, size + 1, format, args...);
+  output.pop_back();
+}
+
+/**
+ * Runs `task(i)` for every i < count on up to `limit` worker threads (inline, without allocating, when only one is
+ * needed). No new tasks start after a failure; @returns the failure with the lowest index, if any.
+ */
+template <typename Task>
+static std::exception_ptr parallel_for(const std::size_t count, const Task& task, const std::size_t limit = nvdv::jobs) {
+  const std::size_t workers = std::min(limit, count);
+  if (workers <= 1) {
+    try {
+      for (std::size_t i = 0; i < count; ++i) task(i);
+    } catch (...) {
+      return std::current_exception();
+    }
+
+    return nullptr;
+  }
+
+  std::atomic<std::size_t> next = 0;
+  std::atomic<bool> failed = false;
+  std::vector<std::exception_ptr> errors(count);
+  const auto work = [&] {
+    for (std::size_t i = 0; !failed && (i = next++) < count;) {
+      try {
+        task(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (std::size_t i = 0; i < workers; ++i) threads.emplace_back(work);
+  for (std::thread& thread : threads) thread.join();
+
+  const auto error = std::find_if(errors.begin(), errors.end(), [](const std::exception_ptr& e) { return !!e; });
+  return error != errors.end() ? *error : nullptr;
+}
+
+/** restores per-command context to its defaults before a resident instance parses the next command */
+static void reset_command() {
+  nvdv::command = {};
+  nvdv::report = nullptr;
+  nvdv::succeeded = 0;
+  nvdv::displays.clear();
+  nvdv::targets.clear();
+  nvdv::keyframes.clear();
+  nvdv::values.clear();
+  nvdv::file.clear();
+  nvdv::output.clear();
+  nvdv::value_to_set = 0;
+  nvdv::drift = 0;
+  nvdv::format = Format::text;
+  nvdv::watch = false;
+  nvdv::ramp_ms = 0;
+  nvdv::fps = 60.0;
+  nvdv::raw = nvdv::all = nvdv::dry_run = nvdv::write_only = nvdv::read_stdin = false;
+}
+
+/** parses a `<display>=<level>` target (display `*` applies to every display without its own target) */
+static std::pair<std::size_t, Level> parse_target(std::string entry) {
+  std::pair<std::size_t, Level> target{};
+  const std::size_t separator = entry.find('=');
+  if (separator == std::string::npos) throw CLI::ValidationError("Invalid target provided (expected `<display>=<level>`)");
+  const std::string display = entry.substr(0, separator);
+  std::string level = entry.substr(separator + 1);
+  if (display != "*" && (!CLI::detail::lexical_cast(display, target.first) || !target.first)) {
+    throw CLI::ValidationError("Invalid display number provided");
+  }
+
+  target.second.raw = nvdv::raw;
+  if (level.starts_with("raw:")) level.erase(0, 4), target.second.raw = true;
+  if (!CLI::detail::lexical_cast(level, target.second.value)) throw CLI::ConversionError("Invalid level provided");
+  return target;
+}
+
+/** reads whitespace separated targets from a state file into `nvdv::targets` (`#` starts a comment) */
+static void load_targets(const std::string& path) {
+  std::ifstream file{path};
+  if (!file) throw CLI::ValidationError("Unable to read state file");
+  for (std::string line; std::getline(file, line);) {
+    std::istringstream entries{line.substr(0, line.find('#'))};
+    for (std::string entry; entries >> entry;) {
+      const auto [display, level] = parse_target(entry);
+      nvdv::targets.insert_or_assign(display, level);
+    }
+  }
+}
+
+/** reads `<t_ms> <display> <level>` lines into `nvdv::keyframes`, selecting their displays (`#` starts a comment) */
+static void load_timeline(const std::string& path) {
+  std::ifstream file{path};
+  if (!file) throw CLI::ValidationError("Unable to read timeline file");
+  for (std::string line; std::getline(file, line);) {
+    std::istringstream fields{line.substr(0, line.find('#'))};
+    std::string ms, display, level, extra;
+    if (!(fields >> ms)) continue;
+    Keyframe keyframe;
+    if (!(fields >> display >> level) || fields >> extra || !CLI::detail::lexical_cast(ms, keyframe.ms)) {
+      throw CLI::ValidationError("Invalid keyframe provided (expected `<t_ms> <display> <level>`)");
+    }
+
+    std::tie(keyframe.display, keyframe.level) = parse_target(display + '=' + level);
+    nvdv::keyframes.push_back(keyframe);
+  }
+
+  if (nvdv::keyframes.empty()) throw CLI::ValidationError("No keyframes provided");
+  nvdv::displays.clear();
+  for (const Keyframe& keyframe : nvdv::keyframes) {
+    nvdv::all |= !keyframe.display;
+    if (keyframe.display && std::ranges::find(nvdv::displays, keyframe.display) == nvdv::displays.end()) {
+      nvdv::displays.push_back(keyframe.display);
+    }
+  }
+}
+
+/** selects the displays named by `nvdv::targets` (every display if a `*` target is present) */
+static void select_targets() {
+  if (nvdv::targets.empty()) throw CLI::ValidationError("No targets provided");
+  nvdv::displays.clear();
+  nvdv::all = nvdv::targets.contains(0);
+  for (const auto& [display, _] : nvdv::targets) {
+    if (display) nvdv::displays.push_back(display);
+  }
+}
+
+/** @returns raw level targeted for the display of `dvc` */
+static NvU32 target_value(const DVC& dvc) {
+  const auto target = nvdv::targets.find(dvc.display);
+  return (target != nvdv::targets.end() ? target : nvdv::targets.find(0))->second.to_raw(dvc);
+}
+
+/** @returns callback summarizing how long the command took since now, prefixed by `what` */
+static std::function<std::string()> report_elapsed(const char* what) {
+  return [what, start = std::chrono::steady_clock::now()] {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    char line[96];
+    const int size = std::snprintf(line, sizeof(line), "%s %zu display(s) in %.3f ms\n", what, nvdv::succeeded,
+      elapsed.count());
+    return std::string(line, static_cast<std::size_t>(size));
+  };
+}
+
+/** @returns `p`-th percentile (0-1) of `samples` */
+static double percentile(std::vector<double> samples, const double p) {
+  if (samples.empty()) return 0.0;
+  const std::size_t rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(samples.size())));
+  const auto nth = samples.begin() + static_cast<std::ptrdiff_t>(std::clamp<std::size_t>(rank, 1, samples.size()) - 1);
+  std::nth_element(samples.begin(), nth, samples.end());
+  return *nth;
+}
+
+/** sleeps until `deadline` without spinning (through a high resolution waitable timer on Windows) */
+static void sleep_until(const std::chrono::steady_clock::time_point deadline) {
+#ifdef _WIN32
+  static thread_local const HANDLE timer{
+    CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS)
+  };
+
+  const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+  if (remaining.count() <= 0) return;
+  LARGE_INTEGER due{};
+  due.QuadPart = -static_cast<LONGLONG>(remaining.count() / 100);  // relative, in 100ns units
+  if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) WaitForSingleObject(timer, INFINITE);
+  else std::this_thread::sleep_until(deadline);
+#else
+  std::this_thread::sleep_until(deadline);
+#endif
+}
+
+/**
+ * Per-display write queue for `--max-rate`. Writes within the rate limit are issued immediately; later ones collapse
+ * into the newest pending value, which a flusher thread issues as soon as the limit allows.
+ */
+class WriteQueue {
+  using clock = std::chrono::steady_clock;
+
+ public:
+  std::size_t posted = 0;
+  std::size_t issued = 0;
+  std::size_t coalesced = 0;  // posted values replaced before reaching the driver
+
+  WriteQueue() = default;
+  WriteQueue(const WriteQueue&) = delete;
+  WriteQueue& operator=(const WriteQueue&) = delete;
+  ~WriteQueue() {
+    {
+      const std::lock_guard lock{mutex};
+      stopping = true;
+    }
+
+    ready.notify_all();
+    if (flusher.joinable()) flusher.join();
+  }
+
+  /** @returns the failure of this write if issued immediately, or of an earlier background write */
+  Result<> post(DVC& dvc, const NvU32 value) {
+    const std::lock_guard lock{mutex};
+    if (Result<> failed = take_failure(); !failed) return failed;
+    ++posted;
+    const clock::time_point now = clock::now();
+    if (!pending && now >= next) return issue(dvc, value, now);
+    if (pending) ++coalesced;
+    pending.emplace(&dvc, value);
+    if (!flusher.joinable()) flusher = std::thread(&WriteQueue::flush_pending, this);
+    ready.notify_all();
+    return {};
+  }
+
+  /** @returns whether a write waits for the flusher, which owns its controller until the write is issued */
+  bool busy() {
+    const std::lock_guard lock{mutex};
+    return pending.has_value();
+  }
+
+  /** waits until the pending write (if any) reached the driver, @returns its failure */
+  Result<> flush() {
+    std::unique_lock lock{mutex};
+    idle.wait(lock, [&] { return !pending; });
+    return take_failure();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::condition_variable idle;
+  std::optional<std::pair<DVC*, NvU32>> pending;
+  std::optional<Failure> failure;
+  clock::time_point next{};
+  bool stopping = false;
+  std::thread flusher;
+
+  Result<> issue(DVC& dvc, const NvU32 value, const clock::time_point now) {
+    next = now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>{1.0 / nvdv::max_rate});
+    ++issued;
+    return dvc.set_raw(value);
+  }
+
+  void flush_pending() {
+    std::unique_lock lock{mutex};
+    for (;;) {
+      ready.wait(lock, [&] { return pending || stopping; });
+      if (ready.wait_until(lock, next, [&] { return stopping; })) return;
+      if (Result<> written = issue(*pending->first, pending->second, clock::now()); !written) {
+        failure = std::move(written.error());
+      }
+
+      pending.reset();
+      idle.notify_all();
+    }
+  }
+
+  Result<> take_failure() {
+    if (!failure) return {};
+    Failure taken = std::move(*failure);
+    failure.reset();
+    return taken;
+  }
+};
+
+namespace nvdv {
+  static std::map<std::size_t, WriteQueue> queues;  // by display, only used with `--max-rate`
+  static std::mutex queues_mutex;
+}  // namespace nvdv
+
+/** writes raw `value` to `dvc`, through its display's write queue when `--max-rate` is given */
+static Result<> write(DVC& dvc, const NvU32 value) {
+  if (nvdv::max_rate <= 0.0) return dvc.set_raw(value);
+  std::unique_lock lock{nvdv::queues_mutex};
+  WriteQueue& queue = nvdv::queues[dvc.display];
+  lock.unlock();
+  return queue.post(dvc, value);
+}
+
+/** waits for every queued write to reach the driver, recording failed ones */
+static void flush_writes() {
+  const std::lock_guard lock{nvdv::queues_mutex};
+  for (auto& [display, queue] : nvdv::queues) {
+    if (Result<> flushed = queue.flush(); !flushed) nvdv::failures.emplace_back(display, std::move(flushed.error()));
+  }
+}
+
+/** @returns whether a queued write to `dvc` has yet to reach the driver */
+static bool write_queued(const DVC& dvc) {
+  const std::lock_guard lock{nvdv::queues_mutex};
+  const auto queue = nvdv::queues.find(dvc.display);
+  return queue != nvdv::queues.end() && queue->second.busy();
+}
+
+/** @returns an `Error: Display <n>: <reason>` line per recorded failure (in display order), clearing them */
+static std::string take_failures() {
+  std::ranges::stable_sort(nvdv::failures, {}, [](const auto& failure) { return failure.first; });
+  std::string report;
+  for (const auto& [display, failure] : nvdv::failures) {
+    report += "Error: Display " + std::to_string(display) + ": " + failure.reason + '\n';
+  }
+
+  nvdv::failures.clear();
+  return report;
+}
+
+/** @returns per-display `set_raw` counters of `controllers`, one line each */
+static std::string level_counters(const std::vector<DVC*>& controllers) {
+  std::string lines;
+  for (const DVC* dvc : controllers) {
+    char line[128];
+    const int size = std::snprintf(line, sizeof(line), "levels %-5zu %zu written, %zu avoided, %zu verified (%zu stale)\n",
+      dvc->display, dvc->written, dvc->avoided, dvc->verified, dvc->stale);
+    lines.append(line, static_cast<std::size_t>(size));
+  }
+
+  return lines;
+}
+
+/** @returns per-display queued write counters, one line each */
+static std::string write_counters() {
+  std::string lines;
+  const std::lock_guard lock{nvdv::queues_mutex};
+  for (const auto& [display, queue] : nvdv::queues) {
+    char line[128];
+    const int size = std::snprintf(line, sizeof(line), "writes %-5zu %zu posted, %zu issued, %zu coalesced\n", display,
+      queue.posted, queue.issued, queue.coalesced);
+    lines.append(line, static_cast<std::size_t>(size));
+  }
+
+  return lines;
+}
+
+/**
+ * Moves `dvc` to raw `target` through intermediate percentages, one `set_raw` per frame at `--fps` over `--ramp`.
+ * Frames are scheduled against absolute deadlines from `nvdv::ramp_start` (or now, when that has passed), so late steps
+ * do not push back the rest of the ramp and the ramps of every display move in step.
+ */
+static Result<> ramp_raw(DVC& dvc, const NvU32 target) {
+  using clock = std::chrono::steady_clock;
+  if (target < dvc.info.min || target > dvc.info.max) return fail("Value out of range", NVAPI_INVALID_ARGUMENT);
+  const std::chrono::duration<double> period{1.0 / nvdv::fps};
+  const double frames = static_cast<double>(nvdv::ramp_ms) / 1000.0 * nvdv::fps;
+  const std::size_t steps = std::max<std::size_t>(1, static_cast<std::size_t>(std::llround(frames)));
+  const double from = dvc.raw_to_percent(dvc.info.cur), to = dvc.raw_to_percent(target);
+
+  std::vector<NvU32> values(steps);
+  for (std::size_t step = 1; step <= steps; ++step) {
+    const double percent = from + (to - from) * static_cast<double>(step) / static_cast<double>(steps);
+    values[step - 1] = static_cast<NvU32>(std::lround(percent));
+  }
+
+  dvc.percent_to_raw(values.data(), values.data(), steps);
+  values.back() = target;
+
+  std::size_t late = 0;
+  std::vector<double> latency;
+  latency.reserve(steps);
+  NvU32 previous = dvc.info.cur;
+  const clock::time_point start = std::max(nvdv::ramp_start, clock::now());
+  for (std::size_t step = 1; step <= steps; ++step) {
+    const NvU32 value = values[step - 1];
+    const clock::time_point deadline = start + std::chrono::duration_cast<clock::duration>(period * step);
+    sleep_until(deadline);
+
+    if (value != previous) {
+      const clock::time_point begin = clock::now();
+      if (Result<> written = write(dvc, value); !written) return written;
+      previous = value;
+      latency.push_back(std::chrono::duration<double, std::milli>(clock::now() - begin).count());
+    }
+
+    if (clock::now() - deadline > period) ++late;
+  }
+
+  if (nvdv::timings) {
+    print("Display %zu ramp: %zu write(s) over %zu step(s) @ %g Hz, set p50 %.3f ms, p99 %.3f ms, %zu late\n",
+      dvc.display, latency.size(), steps, nvdv::fps, percentile(latency, 0.5), percentile(latency, 0.99), late);
+  }
+
+  return {};
+}
+
+/** sets raw `value`, ramping towards it when `--ramp` is given */
+static Result<> transition(DVC& dvc, const NvU32 value) {
+  return nvdv::ramp_ms ? ramp_raw(dvc, value) : write(dvc, value);
+}
+
+/** replaces `nvdv::displays` with every connected display when `--all` is given (or the primary when none are) */
+static void resolve_displays() {
+  if (nvdv::all) {
+    std::size_t n = 0;
+    nvdv::displays.clear();
+    nvdv::displays.resize(nvdv::display_count());
+    std::generate(nvdv::displays.begin(), nvdv::displays.end(), [&] { return ++n; });
+  } else if (nvdv::displays.empty()) {
+    nvdv::displays.push_back(nvdv::primary_display());
+  }
+}
+
+/** appends one `--format` record describing `dvc` to the command output */
+static Result<> print_info(const DVC& dvc) {
+  const auto& [_, cur, min, max]{dvc.info};
+  const bool primary = dvc.display == nvdv::primary_display();
+  const NvU32 percent = dvc.raw_to_percent(cur);
+  switch (nvdv::format) {
+    case Format::text:
+      print("Display %zu%s\n", dvc.display, primary ? "*" : "");
+      print("Current DV: %-2lu (%lu%%)\n", cur, percent);
+      print("Minimum DV: %lu  (0%%)\n", min);
+      print("Maximum DV: %lu (100%%)\n\n", max);
+      break;
+    case Format::json:
+      print(R"({"display":%zu,"primary":%s,"current":%lu,"percent":%lu,"min":%lu,"max":%lu})" "\n", dvc.display,
+        primary ? "true" : "false", cur, percent, min, max);
+      break;
+    case Format::csv:
+    case Format::tsv: {
+      const char* format = nvdv::format == Format::csv ? "%zu,%d,%lu,%lu,%lu,%lu\n" : "%zu\t%d\t%lu\t%lu\t%lu\t%lu\n";
+      print(format, dvc.display, primary, cur, percent, min, max);
+      break;
+    }
+    case Format::binary: {  // little-endian u32s, led by the layout version so pollers can detect changes
+      const std::uint32_t record[6]{
+        BINARY_VERSION, static_cast<std::uint32_t>(dvc.display), primary, static_cast<std::uint32_t>(cur),
+        static_cast<std::uint32_t>(min), static_cast<std::uint32_t>(max),
+      };
+
+      char bytes[sizeof(record)];
+      for (std::size_t i = 0; i < sizeof(record); ++i) bytes[i] = static_cast<char>(record[i / 4] >> (i % 4 * 8));
+      nvdv::sink->append(bytes, sizeof(bytes));
+      break;
+    }
+  }
+
+  return {};
+}
+
+/** @returns CPU time consumed by this process so far */
+static std::chrono::nanoseconds cpu_time() {
+#ifdef _WIN32
+  FILETIME created, exited, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return {};
+  const auto ticks = [](const FILETIME& t) { return (static_cast<std::uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+  return std::chrono::nanoseconds{(ticks(kernel) + ticks(user)) * 100};
+#else
+  timespec now{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+#endif
+}
+
+/**
+ * Re-reads the current level of `controllers` (reusing their handles) until interrupted, printing a record for each
+ * display whose level changed. Polling starts at `--poll-min` and backs off towards `--poll-max` while nothing changes.
+ */
+[[noreturn]] static void watch(const std::vector<DVC*>& controllers) {
+  std::vector<NvU32> last(controllers.size());
+  std::transform(controllers.begin(), controllers.end(), last.begin(), [](const DVC* dvc) { return dvc->info.cur; });
+  std::chrono::milliseconds interval{nvdv::poll_min_ms};
+  std::chrono::nanoseconds cpu{0};
+  nvdv::output.clear();
+  for (std::size_t samples = 1;; ++samples) {
+    sleep_until(std::chrono::steady_clock::now() + interval);
+    const std::chrono::nanoseconds begin = cpu_time();
+    std::vector<Result<>> reads(controllers.size());
+    const std::exception_ptr error = parallel_for(controllers.size(), [&](const std::size_t i) {
+      reads[i] = controllers[i]->refresh();
+    });
+
+    if (error) std::rethrow_exception(error);
+    bool changed = false;
+    for (std::size_t i = 0; i < controllers.size(); ++i) {
+      if (!reads[i]) nvdv::failures.emplace_back(controllers[i]->display, std::move(reads[i].error()));
+      if (!reads[i] || controllers[i]->info.cur == last[i]) continue;
+      last[i] = controllers[i]->info.cur;
+      (void)print_info(*controllers[i]);
+      changed = true;
+    }
+
+    std::fputs(take_failures().c_str(), stderr);  // a display failing one sample is retried on the next
+
+    cpu += cpu_time() - begin;
+    interval = changed ? std::chrono::milliseconds{nvdv::poll_min_ms}
+                       : std::min(interval * 2, std::chrono::milliseconds{nvdv::poll_max_ms});
+    if (!changed) continue;
+    std::fwrite(nvdv::output.data(), 1, nvdv::output.size(), stdout);
+    std::fflush(stdout);
+    nvdv::output.clear();
+    if (nvdv::timings) {
+      const double per_sample = std::chrono::duration<double, std::micro>(cpu).count() / static_cast<double>(samples);
+      std::fprintf(stderr, "watch        %zu sample(s), %.1f us cpu/sample\n", samples, per_sample);
+    }
+  }
+}
+
+/** @returns whether the command can run on cached ranges alone (`--cached-ranges` with a write-only command) */
+static bool skip_dvc_info() {
+  return nvdv::cached_ranges && nvdv::write_only && !nvdv::ramp_ms;
+}
+
+/**
+ * Builds a controller for each selected display. Displays that cannot be controlled are recorded in `nvdv::failures`
+ * and skipped, so the command still runs on the others; @returns failure only if none could be built.
+ */
+static Result<> init_dvc() {
+  if (Result<> connected = nvdv::connect(); !connected) return connected;
+  resolve_displays();
+  const std::vector<std::pair<NvU32, NvU32>>& ranges = nvdv::context().topology.ranges;
+  const bool skip_info = skip_dvc_info();
+  const auto open = [&](const std::size_t n) -> Result<DVC> {
+    if (n < 1 || n > nvdv::display_count()) return fail("Invalid display number provided", NVAPI_INVALID_ARGUMENT);
+    if (skip_info && ranges[n - 1].second) return DVC::open(nvdv::backend(), n, ranges[n - 1]);
+    return DVC::open(nvdv::backend(), n);
+  };
+
+  const auto keep = [](const std::size_t n, Result<DVC>& dvc) {
+    if (dvc) nvdv::controllers.push_back(std::move(*dvc));
+    else nvdv::failures.emplace_back(n, std::move(dvc.error()));
+  };
+
+  nvdv::controllers.reserve(nvdv::displays.size());
+  if (std::min(nvdv::jobs, nvdv::displays.size()) <= 1) {  // already in display order, so nothing is buffered
+    for (const std::size_t n : nvdv::displays) {
+      Result<DVC> dvc = open(n);
+      keep(n, dvc);
+    }
+  } else {
+    std::vector<std::optional<Result<DVC>>> constructed(nvdv::displays.size());
+    const std::exception_ptr error = parallel_for(constructed.size(), [&](const std::size_t i) {
+      constructed[i].emplace(open(nvdv::displays[i]));
+    });
+
+    if (error) std::rethrow_exception(error);
+    for (std::size_t i = 0; i < constructed.size(); ++i) keep(nvdv::displays[i], *constructed[i]);
+  }
+
+  mark_phase("controllers");
+  if (nvdv::controllers.empty()) return fail("Unable to initialize dvc(s) for display(s)");
+  return {};
+}
+
+/** runs the parsed command on `selected` controllers, keeping their output in the given order and their failures */
+static void run_controllers(const std::vector<DVC*>& selected, const bool refresh) {
+  const auto run = [refresh](DVC& dvc) {
+    Result<> result = refresh ? dvc.refresh() : Result<>{};
+    return result ? run_command(dvc) : result;
+  };
+
+  std::size_t succeeded = 0;
+  const auto keep = [&succeeded](const DVC& dvc, Result<>& result) {
+    if (result) ++succeeded;
+    else nvdv::failures.emplace_back(dvc.display, std::move(result.error()));
+  };
+
+  // ramps block for their whole length, so each display gets its own thread regardless of `--jobs`
+  const std::size_t workers = std::min(nvdv::ramp_ms ? selected.size() : nvdv::jobs, selected.size());
+  nvdv::ramp_start = std::chrono::steady_clock::now() + std::chrono::milliseconds{1};  // leaves the workers time to start
+  std::exception_ptr error;
+  if (workers <= 1) {  // output and failures already arrive in display order, so nothing is buffered
+    error = parallel_for(selected.size(), [&](const std::size_t i) {
+      Result<> result = run(*selected[i]);
+      keep(*selected[i], result);
+    }, workers);
+  } else {
+    std::vector<std::string> outputs(selected.size());
+    std::vector<Result<>> results(selected.size());
+    error = parallel_for(selected.size(), [&](const std::size_t i) {
+      nvdv::sink = &outputs[i];
+      results[i] = run(*selected[i]);
+    }, workers);
+
+    nvdv::sink = &nvdv::output;
+    for (const std::string& output : outputs) nvdv::output += output;
+    for (std::size_t i = 0; i < selected.size(); ++i) keep(*selected[i], results[i]);
+  }
+
+  nvdv::context().remember_ranges(selected);
+  if (error) std::rethrow_exception(error);
+  nvdv::succeeded += succeeded;
+}
+
+/**
+ * Plays `nvdv::keyframes` on `selected` controllers. The keyframes are first compiled into a time-sorted schedule of
+ * raw levels per display (a later keyframe for the same time wins, repeated levels are dropped). Each display then
+ * writes its schedule on its own thread against absolute deadlines from a shared start, so lateness never accumulates,
+ * and the spread between scheduled and completed writes is reported.
+ */
+static void play_timeline(const std::vector<DVC*>& selected) {
+  using clock = std::chrono::steady_clock;
+  std::vector<std::vector<std::pair<std::chrono::milliseconds, NvU32>>> schedules(selected.size());
+  std::size_t dropped = 0;
+  for (std::size_t i = 0; i < selected.size(); ++i) {
+    std::vector<std::pair<std::chrono::milliseconds, NvU32>> keyed;
+    for (const Keyframe& keyframe : nvdv::keyframes) {
+      if (keyframe.display && keyframe.display != selected[i]->display) continue;
+      keyed.emplace_back(std::chrono::milliseconds{keyframe.ms}, keyframe.level.to_raw(*selected[i]));
+    }
+
+    std::ranges::stable_sort(keyed, {}, [](const auto& entry) { return entry.first; });
+    for (const auto& entry : keyed) {
+      if (!schedules[i].empty() && schedules[i].back().first == entry.first) schedules[i].back() = entry, ++dropped;
+      else if (!schedules[i].empty() && schedules[i].back().second == entry.second) ++dropped;
+      else schedules[i].push_back(entry);
+    }
+  }
+
+  std::vector<std::vector<double>> errors(selected.size());
+  std::vector<std::optional<Failure>> failures(selected.size());
+  const clock::time_point start = clock::now() + std::chrono::milliseconds{1};  // leaves the players time to start
+  std::vector<std::thread> players;
+  players.reserve(selected.size());
+  for (std::size_t i = 0; i < selected.size(); ++i) {
+    players.emplace_back([&, i] {
+      errors[i].reserve(schedules[i].size());
+      for (const auto& [at, value] : schedules[i]) {
+        const clock::time_point deadline = start + at;
+        sleep_until(deadline);
+        Result<> written = write(*selected[i], value);
+        if (written) errors[i].push_back(std::chrono::duration<double, std::milli>(clock::now() - deadline).count());
+        else if (!failures[i]) failures[i] = std::move(written.error());  // keep playing, reporting the first one
+      }
+    });
+  }
+
+  for (std::thread& player : players) player.join();
+  const std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+  std::vector<double> all;
+  for (std::size_t i = 0; i < selected.size(); ++i) {
+    if (failures[i]) nvdv::failures.emplace_back(selected[i]->display, std::move(*failures[i]));
+    all.insert(all.end(), errors[i].begin(), errors[i].end());
+    if (nvdv::timings) {
+      print("Display %zu timeline: %zu write(s), error p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", selected[i]->display,
+        errors[i].size(), percentile(errors[i], 0.5), percentile(errors[i], 0.99), percentile(errors[i], 1.0));
+    }
+  }
+
+  print("Played %zu write(s) on %zu display(s) in %.3f ms (%zu redundant keyframe(s) dropped)\n", all.size(),
+    selected.size(), elapsed.count(), dropped);
+  print("Timing error p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n", percentile(all, 0.5), percentile(all, 0.9),
+    percentile(all, 0.99), percentile(all, 1.0));
+}
+
+/** (re)builds resident controllers for every connected display */
+static Result<> init_resident() {
+  flush_writes();  // queued writes point into the old controllers
+  nvdv::controllers.clear();
+  nvdv::displays.clear();
+  nvdv::all = true;
+  return init_dvc();
+}
+
+/** runs the parsed command on resident controllers (displays without one are reported as failures) */
+static void run_resident() {
+  resolve_displays();
+  std::vector<DVC*>& selected = nvdv::selected;
+  selected.clear();
+  for (const std::size_t n : nvdv::displays) {
+    const auto dvc = std::ranges::find(nvdv::controllers, n, &DVC::display);
+    if (dvc != nvdv::controllers.end()) selected.push_back(&*dvc);
+    else if (n >= 1 && n <= nvdv::display_count()) nvdv::failures.emplace_back(n, fail("Failed to get display handle"));
+    else nvdv::failures.emplace_back(n, fail("Invalid display number provided", NVAPI_INVALID_ARGUMENT));
+  }
+
+  if (!nvdv::write_only || nvdv::ramp_ms) flush_writes();  // levels the command reads must include queued writes
+  else if (std::ranges::any_of(selected, [](const DVC* dvc) { return write_queued(*dvc); })) {
+    // posts on top of the queued writes (coalescing with them) without touching controllers their flushers still own
+    for (DVC* dvc : selected) {
+      if (Result<> result = run_command(*dvc); result) ++nvdv::succeeded;
+      else nvdv::failures.emplace_back(dvc->display, std::move(result.error()));
+    }
+
+    return;
+  }
+
+  const bool skip_info = skip_dvc_info();
+  if (skip_info) std::for_each(selected.begin(), selected.end(), [](DVC* dvc) { dvc->current = false; });
+  const bool trusted = nvdv::write_only && DVC::verify_ms;  // levels applied earlier are re-read once they expire
+  run_controllers(selected, !skip_info && !trusted);
+}
+
+/** foreground process changes, produced by the OS hook or a scripted source and consumed by `run_profiles` */
+struct FocusEvents {
+  /** @returns next foreground process name, "" once `deadline` passes, or nullopt when the source is exhausted */
+  std::optional<std::string> wait(const std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock lock{mutex};
+    const auto available = [&] { return !queue.empty() || closed; };
+    if (deadline == std::chrono::steady_clock::time_point::max()) ready.wait(lock, available);
+    else if (!ready.wait_until(lock, deadline, available)) return "";
+    if (queue.empty()) return std::nullopt;
+    std::string process = std::move(queue.front());
+    queue.pop_front();
+    return process;
+  }
+
+  void push(std::string process) {
+    if (process.empty()) return;
+    std::ranges::transform(process, process.begin(), [](const unsigned char c) { return std::tolower(c); });
+    const std::lock_guard lock{mutex};
+    queue.push_back(std::move(process));
+    ready.notify_one();
+  }
+
+  void close() {
+    const std::lock_guard lock{mutex};
+    closed = true;
+    ready.notify_one();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::string> queue;
+  bool closed = false;
+};
+
+namespace nvdv {
+  static FocusEvents focus;
+}  // namespace nvdv
+
+#ifdef _WIN32
+/** @returns executable name of the process owning `window` (empty if it cannot be queried) */
+static std::string process_name(HWND window) {
+  DWORD pid = 0;
+  GetWindowThreadProcessId(window, &pid);
+  const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (!process) return {};
+  char path[MAX_PATH];
+  DWORD size = MAX_PATH;
+  const bool queried = QueryFullProcessImageNameA(process, 0, path, &size);
+  CloseHandle(process);
+  return queried ? std::filesystem::path{std::string(path, size)}.filename().string() : std::string{};
+}
+
+/** forwards foreground window changes to `nvdv::focus` from a hook thread with its own message loop */
+static void hook_foreground() {
+  nvdv::focus.push(process_name(GetForegroundWindow()));
+  std::thread([] {
+    const auto on_foreground = [](HWINEVENTHOOK, DWORD, HWND window, LONG, LONG, DWORD, DWORD) {
+      nvdv::focus.push(process_name(window));
+    };
+
+    const DWORD flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+    if (!SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL, on_foreground, 0, 0, flags)) {
+      return nvdv::focus.close();
+    }
+
+    for (MSG message; GetMessage(&message, NULL, 0, 0) > 0;) DispatchMessage(&message);
+  }).detach();
+}
+#endif
+
+/** replays `<t_ms> <process>` lines from a script file into `nvdv::focus`, then closes it */
+static void play_focus_script(const std::string& path) {
+  std::ifstream file{path};
+  if (!file) reject("Unable to read focus event script");
+  std::vector<std::pair<std::size_t, std::string>> events;
+  for (std::string line; std::getline(file, line);) {
+    std::istringstream fields{line.substr(0, line.find('#'))};
+    std::pair<std::size_t, std::string> event;
+    if (fields >> event.first >> event.second) events.push_back(std::move(event));
+  }
+
+  std::thread([events = std::move(events)] {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (const auto& [ms, process] : events) {
+      sleep_until(start + std::chrono::milliseconds{ms});
+      nvdv::focus.push(process);
+    }
+
+    nvdv::focus.close();
+  }).detach();
+}
+
+/** `<process>: <display>=<level>...` rules (`default` matches any other process) */
+using Profiles = std::map<std::string, std::map<std::size_t, Level>>;
+
+/** rules parsed by the `profile` callback, checked against the displays once nvapi is up */
+static Profiles profiles;
+
+static void load_profiles(const std::string& path) {
+  profiles.clear();
+  std::ifstream file{path};
+  if (!file) throw CLI::ValidationError("Unable to read profiles file");
+  for (std::string line; std::getline(file, line);) {
+    line = line.substr(0, line.find('#'));
+    const std::size_t separator = line.find(':');
+    if (separator == std::string::npos) continue;
+    std::string process = CLI::detail::trim_copy(line.substr(0, separator));
+    std::ranges::transform(process, process.begin(), [](const unsigned char c) { return std::tolower(c); });
+    std::map<std::size_t, Level>& targets = profiles[process];
+    std::istringstream entries{line.substr(separator + 1)};
+    for (std::string entry; entries >> entry;) {
+      const auto [display, level] = parse_target(entry);
+      targets.insert_or_assign(display, level);
+    }
+  }
+
+  if (profiles.empty()) throw CLI::ValidationError("No profiles provided");
+}
+
+#ifndef _WIN32
+/** @returns lock file held by the instance with queue `ticket` from drawing it until it releases the instance lock */
+static std::string ticket_path(const std::uint64_t ticket) { return "/tmp/nvdv." + std::to_string(ticket) + ".lock"; }
+#endif
+
+/**
+ * Blocks until this instance holds the instance lock, in arrival order. While waiting, `waiting` (if given) is called
+ * every 50 ms, and the wait is given up once it returns false.
+ *
+ * On POSIX, instances queue through tickets drawn from `/tmp/nvdv.queue`: each holds the lock file of its own ticket
+ * and blocks on the one of its predecessor, which is released when that instance is done (or crashed). An instance
+ * giving up leaves its own file pointing to the ticket it waited for, which its successor then waits for instead.
+ */
+static Result<> acquire_instance(const std::function<bool()>& waiting) {
+#ifdef _WIN32
+  nvdv::handle = CreateMutex(NULL, FALSE, APP_NAME);
+  if (!nvdv::handle) return fail("Unable to create mutex for nvdv handle");
+  DWORD wait;  // an abandoned mutex is acquired all the same
+  while ((wait = WaitForSingleObject(nvdv::handle, waiting ? 50 : INFINITE)) == WAIT_TIMEOUT && waiting()) {}
+  if (wait == WAIT_TIMEOUT || wait == WAIT_FAILED) {
+    CloseHandle(nvdv::handle), nvdv::handle = nullptr;
+    return fail(wait == WAIT_TIMEOUT ? "Timed out waiting for another instance" : "Unable to lock nvdv handle");
+  }
+#else
+  const int counter = open("/tmp/nvdv.queue", O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  if (counter < 0 || flock(counter, LOCK_EX)) {
+    if (counter >= 0) close(counter);
+    return fail("Unable to open lock queue for nvdv handle");
+  }
+
+  std::uint64_t ticket = 0;
+  if (pread(counter, &ticket, sizeof(ticket), 0) != sizeof(ticket)) ticket = 0;
+  const std::uint64_t next = ticket + 1;
+  const int own = open(ticket_path(ticket).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  const bool drawn = own >= 0 && !flock(own, LOCK_EX | LOCK_NB) && pwrite(counter, &next, sizeof(next), 0) > 0;
+  close(counter);
+  if (!drawn) {
+    if (own >= 0) close(own);
+    return fail("Unable to lock nvdv handle");
+  }
+
+  struct sigaction tick{};  // interrupts the blocking `flock` for every call of `waiting`
+  tick.sa_handler = [](int) {};
+  itimerval slices{{0, 50000}, {0, 50000}};
+  if (waiting) sigaction(SIGALRM, &tick, nullptr), setitimer(ITIMER_REAL, &slices, nullptr);
+  Result<> acquired;
+  std::uint64_t awaited = ticket;  // the lock is held once ticket `awaited - 1` is done (or none is left when 0)
+  while (awaited && acquired) {
+    const std::string path = ticket_path(awaited - 1);
+    const int previous = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (previous < 0) acquired = fail("Unable to lock nvdv handle");
+    while (previous >= 0 && flock(previous, LOCK_EX) && acquired) {
+      if (errno != EINTR) acquired = fail("Unable to lock nvdv handle");
+      else if (!waiting()) acquired = fail("Timed out waiting for another instance");
+    }
+
+    if (acquired && pread(previous, &awaited, sizeof(awaited), 0) != sizeof(awaited)) awaited = 0;  // unless it left
+    if (acquired) unlink(path.c_str());
+    if (previous >= 0) close(previous);
+  }
+
+  slices = {};
+  if (waiting) setitimer(ITIMER_REAL, &slices, nullptr), signal(SIGALRM, SIG_DFL);
+  if (!acquired) {  // leaves the queue, handing the ticket this instance still waited for to its successor
+    const bool handed = pwrite(own, &awaited, sizeof(awaited), 0) == sizeof(awaited);
+    close(own);
+    return handed ? acquired : fail("Unable to leave the nvdv lock queue");
+  }
+
+  nvdv::handle = own;
+#endif
+  return {};
+}
+
+/** releases the instance lock (if held) so other instances can run */
+static void unlock_instance() {
+#ifdef _WIN32
+  if (!nvdv::handle) return;
+  ReleaseMutex(nvdv::handle);
+  CloseHandle(nvdv::handle);
+  nvdv::handle = nullptr;
+#else
+  if (nvdv::handle >= 0) close(nvdv::handle);
+  nvdv::handle = -1;
+#endif
+}
+
+/** waits for the instance lock again, around a short critical section of a long-running command */
+static void lock_instance() { (void)acquire_instance(nullptr); }
+
+/**
+ * Applies the profile of each foreground process to the resident controllers. Focus changes are debounced: a burst
+ * of events within `--debounce` of each other is coalesced into its last one, costing at most one write per display.
+ * Displays a profile does not mention, and every display while no profile matches, return to their starting level.
+ */
+static int run_profiles(const std::string& script) {
+  const Result<> built = init_resident();
+  // display numbers are only known once nvapi is up, so rules for missing ones are reported and dropped
+  std::map<std::size_t, Level> missing;
+  for (auto& [process, targets] : profiles) {
+    while (built && !targets.empty() && targets.rbegin()->first > nvdv::display_count()) {
+      missing.insert(targets.extract(targets.rbegin()->first));
+    }
+  }
+
+  for (const auto& [display, level] : missing) {
+    nvdv::failures.emplace_back(display, fail("Invalid display number provided", NVAPI_INVALID_ARGUMENT));
+  }
+
+  std::fputs(take_failures().c_str(), stderr);  // profiles still apply to the displays that could be controlled
+  if (!built) return std::fprintf(stderr, "Error: %s\n", built.error().reason.c_str()), 1;
+  std::vector<NvU32> baseline(nvdv::controllers.size()), applied(nvdv::controllers.size());
+  std::transform(nvdv::controllers.begin(), nvdv::controllers.end(), baseline.begin(), [](const DVC& dvc) {
+    return dvc.info.cur;
+  });
+
+  applied = baseline;
+  unlock_instance();  // like `info --watch`, other commands (hotkeys) run freely between profile switches
+  if (!script.empty()) play_focus_script(script);
+#ifdef _WIN32
+  else hook_foreground();
+#else
+  else {
+    std::fputs("Error: Foreground process tracking requires Windows (use `--events` to script focus changes)\n", stderr);
+    return 1;
+  }
+#endif
+
+  using clock = std::chrono::steady_clock;
+  const Profiles::const_iterator fallback = profiles.find("default");
+  Profiles::const_iterator active = profiles.end();
+  std::optional<std::string> pending;
+  std::size_t events = 0;
+  clock::time_point settle = clock::time_point::max();
+  for (;;) {
+    const std::optional<std::string> process = nvdv::focus.wait(pending ? settle : clock::time_point::max());
+    if (process && !process->empty()) {
+      pending = *process, ++events;
+      settle = clock::now() + std::chrono::milliseconds{nvdv::debounce_ms};
+      continue;
+    }
+
+    if (pending) {
+      const Profiles::const_iterator match = profiles.find(*pending);
+      const Profiles::const_iterator profile = match != profiles.end() ? match : fallback;
+      if (profile != active) {
+        std::size_t writes = 0;
+        lock_instance();
+        for (std::size_t i = 0; i < nvdv::controllers.size(); ++i) {
+          DVC& dvc = nvdv::controllers[i];
+          dvc.current = false;  // other instances may have changed the level since
+          NvU32 value = baseline[i];
+          if (profile != profiles.end()) {
+            const auto target = profile->second.find(dvc.display);
+            const auto any = profile->second.find(0);
+            if (target != profile->second.end()) value = target->second.to_raw(dvc);
+            else if (any != profile->second.end()) value = any->second.to_raw(dvc);
+          }
+
+          if (value == applied[i]) continue;
+          if (Result<> written = write(dvc, value); !written) {
+            nvdv::failures.emplace_back(dvc.display, std::move(written.error()));
+            continue;  // retried on the next profile switch
+          }
+
+          applied[i] = value, ++writes;
+        }
+
+        flush_writes();
+        unlock_instance();
+        active = profile;
+        const char* name = profile != profiles.end() ? profile->first.c_str() : "none";
+        print("Profile %s: %zu write(s), %zu focus event(s)\n", name, writes, events);
+        std::fwrite(nvdv::output.data(), 1, nvdv::output.size(), stdout);
+        std::fflush(stdout);
+        std::fputs(take_failures().c_str(), stderr);
+        nvdv::output.clear();
+      }
+
+      pending.reset(), events = 0;
+    }
+
+    if (!process) return 0;
+  }
+}
+
+/**
+ * Local IPC connection used by `serve` (named pipe on Windows, unix domain socket elsewhere).
+ * A request is a u32 payload size (at most `MAX_REQUEST`) followed by the client's NUL-terminated working directory
+ * and args; the reply is the exit code byte, a flags byte (bit 0: stdout is binary, bit 1: run the command in the
+ * client instead), a u32 stdout size, stdout, then stderr until the server closes the connection. The server gives up
+ * on a client whose request or reply does not move for `TIMEOUT_MS`.
+ */
+struct Connection {
+  static constexpr std::uint32_t MAX_REQUEST = 64 * 1024;
+  static constexpr unsigned TIMEOUT_MS = 1000;
+#ifdef _WIN32
+  static constexpr const char* ADDRESS = R"(\\.\pipe\nvdv)";
+  HANDLE handle{INVALID_HANDLE_VALUE};
+  bool served{false};  // pipe instance created by `listen`, for overlapped I/O bounded by `TIMEOUT_MS`
+  ~Connection() { handle != INVALID_HANDLE_VALUE && CloseHandle(handle); }
+
+  /** runs overlapped `start` on a served pipe instance, cancelled after `timeout_ms`; @returns whether it succeeded */
+  template <typename Start>
+  bool overlapped(const Start& start, DWORD& n, const DWORD timeout_ms) const {
+    OVERLAPPED io{};
+    if (!(io.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL))) return false;
+    n = 0;
+    const BOOL started = start(&io);
+    const DWORD error = started ? ERROR_SUCCESS : GetLastError();
+    if (error == ERROR_IO_PENDING && WaitForSingleObject(io.hEvent, timeout_ms) != WAIT_OBJECT_0) {
+      CancelIoEx(handle, &io);
+    }
+
+    const bool done = error == ERROR_PIPE_CONNECTED ||
+      ((started || error == ERROR_IO_PENDING) && GetOverlappedResult(handle, &io, &n, TRUE));
+    CloseHandle(io.hEvent);
+    return done;
+  }
+
+  std::size_t recv(char* data, const std::size_t size) const {
+    DWORD n = 0;
+    if (!served) return ReadFile(handle, data, static_cast<DWORD>(size), &n, NULL) ? n : 0;
+    const auto read = [&](OVERLAPPED* io) { return ReadFile(handle, data, static_cast<DWORD>(size), NULL, io); };
+    return overlapped(read, n, TIMEOUT_MS) ? n : 0;
+  }
+
+  bool send(const char* data, const std::size_t size) const {
+    DWORD n = 0;
+    if (!served) return WriteFile(handle, data, static_cast<DWORD>(size), &n, NULL) && n == size;
+    const auto write = [&](OVERLAPPED* io) { return WriteFile(handle, data, static_cast<DWORD>(size), NULL, io); };
+    return overlapped(write, n, TIMEOUT_MS) && n == size;
+  }
+
+  /** waits for a client to connect to this served pipe instance */
+  bool accept() const {
+    DWORD n = 0;
+    return overlapped([&](OVERLAPPED* io) { return ConnectNamedPipe(handle, io); }, n, INFINITE);
+  }
+
+  /** @returns a new served pipe instance, or an invalid handle */
+  static HANDLE listen() {
+    const DWORD mode = PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS;
+    const DWORD access = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+    return CreateNamedPipe(ADDRESS, access, mode, PIPE_UNLIMITED_INSTANCES, 4096, 4096, 0, NULL);
+  }
+
+  bool connect() {
+    handle = CreateFile(ADDRESS, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (handle == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY && WaitNamedPipe(ADDRESS, 1000)) {
+      handle = CreateFile(ADDRESS, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    }
+
+    return handle != INVALID_HANDLE_VALUE;
+  }
+#else
+  static constexpr const char* ADDRESS = "/tmp/nvdv.sock";
+  int handle{-1};
+  ~Connection() { handle >= 0 && close(handle); }
+
+  std::size_t recv(char* data, const std::size_t size) const {
+    const ssize_t n = read(handle, data, size);
+    return n > 0 ? static_cast<std::size_t>(n) : 0;
+  }
+
+  bool send(const char* data, std::size_t size) const {
+    for (ssize_t n = 0; size; data += n, size -= static_cast<std::size_t>(n)) {
+      if ((n = write(handle, data, size)) <= 0) return false;
+    }
+
+    return true;
+  }
+
+  static sockaddr_un address() {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, ADDRESS, sizeof(addr.sun_path) - 1);
+    return addr;
+  }
+
+  /** @returns listening socket, or -1 */
+  static int listen() {
+    const sockaddr_un addr = address();
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(ADDRESS);  // stale socket from a crashed server (the instance lock is already held)
+    if (fd >= 0 && !bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) && !::listen(fd, SOMAXCONN)) {
+      return fd;
+    }
+
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+
+  /** bounds every read and write on this accepted client by `TIMEOUT_MS` */
+  void bound() const {
+    const timeval timeout{TIMEOUT_MS / 1000, TIMEOUT_MS % 1000 * 1000};
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(handle, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  }
+
+  bool connect() {
+    const sockaddr_un addr = address();
+    if ((handle = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return false;
+    return !::connect(handle, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+  }
+#endif
+
+  bool recv_all(char* data, std::size_t size) const {
+    for (std::size_t n = 0; size; data += n, size -= n) {
+      if (!(n = recv(data, size))) return false;
+    }
+
+    return true;
+  }
+
+  std::string recv_rest() const {
+    std::string data;
+    char buffer[4096];
+    for (std::size_t n = 0; (n = recv(buffer, sizeof(buffer)));) data.append(buffer, n);
+    return data;
+  }
+};
+
+/** switches stdout to binary mode, so Windows does not translate `\n` bytes inside binary records */
+static void binary_stdout() {
+#ifdef _WIN32
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+/**
+ * @returns exit code of the command as run by a resident `serve` instance, or nullopt if none is running (or it handed
+ * a read-only command back, setting `nvdv::beside_server`)
+ */
+template <typename Char>
+static std::optional<int> forward_to_server(const int argc, Char* argv[]) {
+  Connection server;
+  if (!server.connect()) return std::nullopt;
+  std::string request(sizeof(std::uint32_t), '\0');
+  std::error_code error;
+  const std::filesystem::path cwd = std::filesystem::current_path(error);  // relative paths are the client's
+  if constexpr (std::is_same_v<Char, wchar_t>) request += CLI::narrow(cwd.wstring());
+  else request += cwd.string();
+  request += '\0';
+  for (int i = 1; i < argc; ++i) {
+    if constexpr (std::is_same_v<Char, wchar_t>) request += CLI::narrow(argv[i]);
+    else request += argv[i];
+    request += '\0';
+  }
+
+  const std::uint32_t size = static_cast<std::uint32_t>(request.size() - sizeof(size));
+  std::memcpy(request.data(), &size, sizeof(size));
+  if (!server.send(request.data(), request.size())) return std::nullopt;
+
+  const std::string reply = server.recv_rest();
+  std::uint32_t out_size = 0;
+  constexpr std::size_t HEADER = 2 + sizeof(out_size);
+  if (reply.size() < HEADER) return std::fputs("Error: Lost connection to nvdv server\n", stderr), 1;
+  if (reply[1] & 2) return nvdv::beside_server = true, std::nullopt;
+  std::memcpy(&out_size, reply.data() + 2, sizeof(out_size));
+  const std::string_view out = std::string_view{reply}.substr(HEADER, out_size);
+  const std::string_view err = std::string_view{reply}.substr(HEADER + out.size());
+  if (reply[1] & 1) binary_stdout();
+  std::fwrite(out.data(), 1, out.size(), stdout);
+  std::fwrite(err.data(), 1, err.size(), stderr);
+  return static_cast<unsigned char>(reply.front());
+}
+
+/** instance-level options, which a request to a resident instance only overrides for itself */
+struct Settings {
+  std::size_t jobs = nvdv::jobs;
+  double max_rate = nvdv::max_rate;
+  std::string trace = Trace::path;
+  bool tracing = Trace::enabled;
+  bool timings = nvdv::timings;
+  bool cached_ranges = nvdv::cached_ranges;
+  bool rescan = nvdv::rescan;
+  std::size_t verify_ms = DVC::verify_ms;
+  std::size_t deadline_ms = Watchdog::deadline_ms;
+  std::size_t budget_ms = Watchdog::budget_ms;
+  std::size_t retries = Watchdog::retries;
+  std::size_t backoff_ms = Watchdog::backoff_ms;
+  std::size_t poll_min_ms = nvdv::poll_min_ms;
+  std::size_t poll_max_ms = nvdv::poll_max_ms;
+  std::size_t debounce_ms = nvdv::debounce_ms;
+
+  void restore() const {
+    nvdv::jobs = jobs, nvdv::max_rate = max_rate, Trace::path = trace, Trace::enabled = tracing;
+    nvdv::timings = timings, nvdv::cached_ranges = cached_ranges, nvdv::rescan = rescan;
+    DVC::verify_ms = verify_ms;
+    Watchdog::deadline_ms = deadline_ms, Watchdog::budget_ms = budget_ms;
+    Watchdog::retries = retries, Watchdog::backoff_ms = backoff_ms;
+    nvdv::poll_min_ms = poll_min_ms, nvdv::poll_max_ms = poll_max_ms, nvdv::debounce_ms = debounce_ms;
+  }
+};
+
+/**
+ * Parses and runs one command (`args` without the program name) against the resident controllers, on behalf of
+ * `source` (a server client or `--stdin`). @returns its exit code, appending its output to `out` and errors to `err`.
+ */
+static int run_request(CLI::App& app, std::vector<std::string> args, const char* source, std::ostream& out,
+  std::ostream& err) {
+  int code = 0;
+  const Settings settings;
+  std::optional<std::size_t> traced;  // first span of this request, when it gave its own `--trace` file
+  echo_rejections = false;  // they go to `err` like every other error of the request
+  Watchdog::start = Watchdog::clock::now();  // `--budget` covers this request only
+  try {
+    Result<bool> synced = nvdv::context().sync();
+    if (!synced) reject(synced.error().reason.c_str());
+    if (*synced) {
+      if (const Result<> built = init_resident(); !built) reject(built.error().reason.c_str());
+    }
+
+    reset_command();
+    std::reverse(args.begin(), args.end());
+    {
+      const Span span{"CLI11 parse"};
+      app.parse(args);
+    }
+
+    if (nvdv::serving && app.got_subcommand("serve")) reject("nvdv server is already running");
+    if (nvdv::watch || nvdv::read_stdin || !nvdv::keyframes.empty() || app.got_subcommand("profile") ||
+      app.got_subcommand("serve")) {
+      const char* hint = nvdv::serving ? "; stop the server to run them" : "";
+      reject((std::string{"Long-running commands are not supported through "} + source + hint).c_str());
+    }
+
+    if (app.get_option("--trace")->count()) traced = Trace::mark(), Trace::enabled = true;
+    run_resident();
+    if (nvdv::timings) {
+      std::vector<DVC*> resident;
+      for (DVC& dvc : nvdv::controllers) resident.push_back(&dvc);
+      if (nvdv::report) err << nvdv::report();
+      err << level_counters(resident) << write_counters() << Watchdog::counters();
+    }
+  } catch (const CLI::ParseError& e) {
+    code = app.exit(e, out, err);
+  } catch (const std::exception& e) {
+    code = 1, err << "Error: " << e.what() << '\n';
+  }
+
+  if (const std::string failures = take_failures(); !failures.empty()) code = 1, err << failures;
+  if (traced) Trace::write_since(*traced, Trace::path);  // while relative paths still resolve as the client's
+  settings.restore();
+  echo_rejections = true;
+  out << nvdv::output;
+  return code;
+}
+
+/** parses and runs one forwarded request against the resident controllers */
+static void handle_request(CLI::App& app, const Connection& client) {
+  std::uint32_t size = 0;
+  if (!client.recv_all(reinterpret_cast<char*>(&size), sizeof(size)) || size > Connection::MAX_REQUEST) return;
+  std::string payload(size, '\0');
+  if (!client.recv_all(payload.data(), size)) return;
+
+  std::vector<std::string> args;
+  for (const char* arg = payload.data(); arg < payload.data() + payload.size(); arg += std::strlen(arg) + 1) {
+    args.emplace_back(arg);
+  }
+
+  if (args.empty()) return;
+  std::error_code error;
+  const std::filesystem::path own = std::filesystem::current_path(error);  // resolve file arguments as the client would
+#ifdef _WIN32
+  std::filesystem::current_path(CLI::widen(args.front()), error);
+#else
+  std::filesystem::current_path(args.front(), error);
+#endif
+  args.erase(args.begin());
+  std::ostringstream out, err;
+  const int code = run_request(app, std::move(args), "nvdv server", out, err);
+  std::filesystem::current_path(own, error);
+  // `info --watch` only reads after its first sample, so the client runs it itself next to this instance
+  if (nvdv::watch) out.str(""), err.str("");
+  const char flags = nvdv::watch ? 2 : nvdv::format == Format::binary;
+  std::string reply{static_cast<char>(code), flags};
+  const std::uint32_t out_size = static_cast<std::uint32_t>(out.view().size());
+  reply.append(reinterpret_cast<const char*>(&out_size), sizeof(out_size));
+  reply.append(out.view()).append(err.view());
+  client.send(reply.data(), reply.size());
+}
+
+/**
+ * Runs newline-delimited commands from stdin (`--stdin`) against one set of resident controllers, initializing the
+ * driver once per stream. Each command answers with a result line, `ok <n>` or `error <n>: <reasons>`, followed by
+ * exactly `n` bytes of command output, so output lines can never be mistaken for results.
+ */
+static int run_stdin(CLI::App& app) {
+  const Result<> built = init_resident();
+  std::fputs(take_failures().c_str(), stderr);
+  if (!built) return std::fprintf(stderr, "Error: %s\n", built.error().reason.c_str()), 1;
+  binary_stdout();  // output sizes count bytes as written
+  int code = 0;
+  for (std::string line; std::getline(std::cin, line);) {
+    std::vector<std::string> args = CLI::detail::split_up(CLI::detail::trim_copy(line.substr(0, line.find('#'))));
+    std::erase_if(args, [](const std::string& arg) { return arg.empty(); });
+    if (args.empty()) continue;
+    std::ostringstream out, err;
+    const int status = run_request(app, std::move(args), "--stdin", out, err);
+    std::string reasons, diagnostics;
+    std::istringstream lines{err.str()};
+    for (std::string message; std::getline(lines, message);) {
+      if (message.starts_with("Error: ")) (reasons.empty() ? reasons : reasons += "; ") += message.substr(7);
+      else diagnostics += message + '\n';
+    }
+
+    if (status && reasons.empty()) reasons = diagnostics.substr(0, diagnostics.find('\n'));
+    std::fputs(diagnostics.c_str(), stderr);
+    if (status) std::printf("error %zu: %s\n", out.view().size(), reasons.c_str()), code = 1;
+    else std::printf("ok %zu\n", out.view().size());
+    std::fwrite(out.view().data(), 1, out.view().size(), stdout);
+    std::fflush(stdout);
+  }
+
+  flush_writes();
+  std::fputs(take_failures().c_str(), stderr);
+  return code;
+}
+
+/**
+ * Keeps the driver and all controllers resident, serving forwarded commands one at a time until killed;
+ * @returns exit code when the server cannot start
+ */
+static int run_server(CLI::App& app) {
+  const Result<> built = init_resident();
+  std::fputs(take_failures().c_str(), stderr);
+  if (!built) return std::fprintf(stderr, "Error: %s\n", built.error().reason.c_str()), 1;
+  if (nvdv::timings) print_phases();
+  nvdv::serving = true;
+#ifdef _WIN32
+  for (HANDLE pipe = Connection::listen();;) {
+    if (pipe == INVALID_HANDLE_VALUE) return std::fputs("Error: Unable to create pipe for nvdv server\n", stderr), 1;
+    const Connection client{pipe, true};
+    const bool connected = client.accept();
+    pipe = Connection::listen();  // keep an instance listening while this request is handled
+    if (!connected) continue;
+    handle_request(app, client);
+    FlushFileBuffers(client.handle);
+    DisconnectNamedPipe(client.handle);
+  }
+#else
+  signal(SIGPIPE, SIG_IGN);
+  const int fd = Connection::listen();
+  if (fd < 0) return std::fputs("Error: Unable to create socket for nvdv server\n", stderr), 1;
+  for (;;) {
+    const Connection client{accept(fd, NULL, NULL)};
+    if (client.handle < 0) continue;
+    client.bound();
+    handle_request(app, client);
+  }
+#endif
+}
+
+static void cleanup() {
+#ifndef _WIN32
+  if (nvdv::serving) unlink(Connection::ADDRESS);
+#endif
+  unlock_instance();
+}
+
+/**
+ * Takes the instance lock after every instance that asked for it earlier, waiting up to `NVDV_LOCK_TIMEOUT_MS` (as
+ * long as it takes by default). A `serve` instance taking over meanwhile gets the command instead.
+ * @returns its exit code if it did, or 1 if the lock could not be taken.
+ */
+template <typename Char>
+static std::optional<int> ensure_single_instance(const int argc, Char* argv[]) {
+  using clock = std::chrono::steady_clock;
+  const std::int64_t timeout_ms = env_or<std::int64_t>("NVDV_LOCK_TIMEOUT_MS", 0);
+  const clock::time_point deadline = timeout_ms > 0 ? clock::now() + std::chrono::milliseconds{timeout_ms}
+                                                    : clock::time_point::max();
+  std::optional<int> forwarded;
+  const Result<> locked = acquire_instance([&] {
+    return !(forwarded = forward_to_server(argc, argv)) && !nvdv::beside_server && clock::now() < deadline;
+  });
+
+  if (forwarded) return forwarded;
+  if (nvdv::beside_server) return std::nullopt;
+  if (!locked) return std::fprintf(stderr, "Error: %s\n", locked.error().reason.c_str()), 1;
+  mark_phase("lock");
+  for (const int sig : ABORT_SIGNALS) signal(sig, [](const int code) { cleanup(), std::exit(code); });
+  std::atexit(cleanup), std::at_quick_exit(cleanup);
+  return std::nullopt;
+}
+
+Result<> commands::Info::operator()(DVC& dvc) const { return print_info(dvc); }
+
+Result<> commands::Toggle::operator()(DVC& dvc) const {
+  return transition(dvc, dvc.info.cur > dvc.info.min ? dvc.info.min : dvc.info.max);
+}
+
+Result<> commands::Disable::operator()(DVC& dvc) const { return transition(dvc, dvc.info.min); }
+
+Result<> commands::Enable::operator()(DVC& dvc) const { return transition(dvc, dvc.info.max); }
+
+Result<> commands::Set::operator()(DVC& dvc) const {
+  return transition(dvc, nvdv::raw ? nvdv::value_to_set : dvc.percent_to_raw(nvdv::value_to_set));
+}
+
+Result<> commands::SetTargets::operator()(DVC& dvc) const { return transition(dvc, target_value(dvc)); }
+
+Result<> commands::Apply::operator()(DVC& dvc) const {
+  const NvU32 value = target_value(dvc);
+  if (value == dvc.info.cur) return {};
+  ++nvdv::drift;
+  print("Display %zu: %lu -> %lu\n", dvc.display, dvc.info.cur, value);
+  return nvdv::dry_run ? Result<>{} : write(dvc, value);
+}
+
+/** adds every option and subcommand to `app` */
+static void define_commands(CLI::App& app) {
+  app.set_version_flag("-v,--version", APP_VERSION);
+  app.fallthrough();  // global options may also follow the subcommand (`set 70 -d 2`)
+  app.add_option("-d,--display", nvdv::displays, "Specify other display number (handles only primary by default)");
+  app.add_flag("-a,--all", nvdv::all, "Handle all available displays (overrides `--display`)");
+  app.add_flag("--timings", nvdv::timings, "Print startup phase timings to stderr");
+  app.add_option("--trace", Trace::path, "Write a Chrome trace (JSON timeline) of driver calls to the given file");
+  app.add_flag("--cached-ranges", nvdv::cached_ranges, "Skip reading DVC info for set/enable/disable when cached");
+  app.add_flag("--rescan", nvdv::rescan, "Enumerate displays even if the cached topology snapshot is current");
+  app.add_option("-j,--jobs", nvdv::jobs, "Number of worker threads handling displays concurrently")
+    ->check(CLI::PositiveNumber);
+  app.add_option("--ramp", nvdv::ramp_ms, "Fade level changes over the given milliseconds instead of jumping");
+  app.add_option("--fps", nvdv::fps, "Ramp steps per second (defaults to 60)")->check(CLI::Range(1.0, 1000.0));
+  app.add_option("--verify", DVC::verify_ms, "Re-read levels not read for this many ms before skipping a write");
+  app.add_option("--max-rate", nvdv::max_rate, "Limit writes per second and display, coalescing to the newest level")
+    ->check(CLI::NonNegativeNumber);
+  app.add_option("--deadline", Watchdog::deadline_ms, "Give up on driver calls taking longer than this many ms");
+  app.add_option("--budget", Watchdog::budget_ms, "Give up on driver calls once the command has run this many ms");
+  app.add_option("--retries", Watchdog::retries, "Retry driver calls missing their deadline up to this many times");
+  app.add_option("--backoff", Watchdog::backoff_ms, "Wait this many ms before the first retry, doubling for each next");
+  app.add_flag("--stdin", nvdv::read_stdin, "Run newline-delimited commands from stdin, answering `ok|error <bytes>`");
+  static const std::map<std::string, Format> FORMATS{
+    {"text", Format::text}, {"json", Format::json}, {"csv", Format::csv}, {"tsv", Format::tsv}, {"binary", Format::binary},
+  };
+
+  static CLI::App* info{app.add_subcommand("info", "output current digital vibrance control info")};
+  info->add_option("-f,--format", nvdv::format, "text, json (one object per line), csv, tsv or binary")
+    ->transform(CLI::CheckedTransformer(FORMATS, CLI::ignore_case));
+  info->add_flag("-w,--watch", nvdv::watch, "keep running, printing a record whenever a display's level changes");
+  info->add_option("--poll-min", nvdv::poll_min_ms, "fastest watch poll interval in ms (used right after a change)")
+    ->check(CLI::PositiveNumber);
+  info->add_option("--poll-max", nvdv::poll_max_ms, "slowest watch poll interval in ms (backed off to while idle)")
+    ->check(CLI::PositiveNumber);
+  info->callback([] {
+    if (nvdv::poll_max_ms < nvdv::poll_min_ms) nvdv::poll_max_ms = nvdv::poll_min_ms;
+    if (nvdv::format == Format::csv) print("display,primary,current,percent,min,max\n");
+    if (nvdv::format == Format::tsv) print("display\tprimary\tcurrent\tpercent\tmin\tmax\n");
+    nvdv::command = commands::Info{};
+  });
+
+  app.add_subcommand("toggle", "toggle current digital vibrance (between min and max)")->callback([] {
+    nvdv::command = commands::Toggle{};
+  });
+
+  app.add_subcommand("disable", "disable current digital vibrance (set to min)")->callback([] {
+    nvdv::command = commands::Disable{};
+    nvdv::write_only = true;
+  });
+
+  app.add_subcommand("enable", "enable current digital vibrance (set to max)")->callback([] {
+    nvdv::command = commands::Enable{};
+    nvdv::write_only = true;
+  });
+
+  static CLI::App* set{app.add_subcommand("set", "set current digital vibrance level")};
+  set->add_flag("-r,--raw", nvdv::raw, "use raw values instead of percentage based scale");
+  set->add_option("value", nvdv::values, "value in range [0, 100] (unless `--raw` is given), or `<display>=<level>` targets");
+  set->add_option("-f,--file", nvdv::file, "read `<display>=<level>` targets from a file")->check(CLI::ExistingFile);
+  set->callback([] {
+    if (nvdv::file.empty() && nvdv::values.size() == 1 && nvdv::values.front().find('=') == std::string::npos) {
+      if (!CLI::detail::lexical_cast(nvdv::values.front(), nvdv::value_to_set)) {
+        throw CLI::ConversionError("Invalid level provided");
+      }
+
+      nvdv::command = commands::Set{};
+      nvdv::write_only = true;
+      return;
+    }
+
+    if (nvdv::file.empty() && nvdv::values.empty()) throw CLI::RequiredError("value");
+    if (!nvdv::file.empty()) load_targets(nvdv::file);
+    for (const std::string& entry : nvdv::values) {
+      const auto [display, level] = parse_target(entry);
+      nvdv::targets.insert_or_assign(display, level);
+    }
+
+    select_targets();
+    nvdv::command = commands::SetTargets{};
+    nvdv::write_only = true;
+    nvdv::report = report_elapsed("Set");
+  });
+
+  static CLI::App* apply{app.add_subcommand("apply", "converge display(s) to the levels declared in a state file")};
+  apply->add_flag("-n,--dry-run", nvdv::dry_run, "report drift without applying it");
+  apply->add_option("file", nvdv::file, "whitespace separated `<display>=<level>` entries (`*` for any display)")
+    ->check(CLI::ExistingFile)
+    ->required();
+
+  apply->callback([] {
+    load_targets(nvdv::file);
+    select_targets();
+    nvdv::command = commands::Apply{};
+
+    nvdv::report = [start = std::chrono::steady_clock::now()] {
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      char line[96];
+      const char* outcome = nvdv::dry_run ? "Drifted" : "Applied";
+      const int size = nvdv::drift
+        ? std::snprintf(line, sizeof(line), "%s %zu of %zu display(s) in %.3f ms\n", outcome, nvdv::drift.load(),
+            nvdv::succeeded, elapsed.count())
+        : std::snprintf(line, sizeof(line), "Converged %zu display(s) in %.3f ms\n", nvdv::succeeded, elapsed.count());
+      return std::string(line, static_cast<std::size_t>(size));
+    };
+  });
+
+  CLI::App* play{app.add_subcommand("play", "play a timeline of keyframes across display(s) on a drift-free timer")};
+  play->add_option("timeline", nvdv::file, "`<t_ms> <display> <level>` lines (`*` for every display)")
+    ->check(CLI::ExistingFile)
+    ->required();
+
+  play->callback([] { load_timeline(nvdv::file); });
+
+  CLI::App* profile{app.add_subcommand("profile", "apply per-application levels while processes are focused")};
+  profile->add_option("rules", nvdv::file, "`<process>: <display>=<level>...` lines (`default` for any other process)")
+    ->check(CLI::ExistingFile)
+    ->required();
+  profile->add_option("--debounce", nvdv::debounce_ms, "coalesce focus changes settling within this many ms");
+  profile->add_option("--events", nvdv::events, "replay `<t_ms> <process>` focus changes from a file instead of the OS")
+    ->check(CLI::ExistingFile);
+
+  profile->callback([] { load_profiles(nvdv::file); });
+
+  app.add_subcommand("serve", "keep nvapi and dvc(s) resident, running commands from other instances "
+    "(`info --watch` runs beside it; `play`, `profile` and `--stdin` need it stopped)");
+  app.require_subcommand(0, 1);
+  app.callback([&app] {  // a subcommand is required, unless they are read from stdin
+    if (nvdv::read_stdin && !app.get_subcommands().empty()) throw CLI::ExcludesError("--stdin", "subcommands");
+    if (!nvdv::read_stdin && app.get_subcommands().empty()) throw CLI::RequiredError::Subcommand(1);
+  });
+}
+
+/**
+ * Recognizes `[-a | -d <n>]... (set <n> | toggle | enable | disable)` without building the CLI11 app. Parsing
+ * allocates nothing (storing `-d` displays allocates once). @returns false for anything else, which goes to CLI11.
+ */
+template <typename Char>
+static bool parse_fast(const int argc, const Char* const argv[]) {
+  const auto is = [](const Char* arg, const char* literal) {
+    for (; *literal; ++arg, ++literal) {
+      if (*arg != static_cast<Char>(*literal)) return false;
+    }
+
+    return !*arg;
+  };
+
+  const auto number = [](const Char* arg, NvU32& value) {
+    if (*arg == '0' && arg[1]) return false;  // CLI11 reads a leading `0` as octal (or `0x` as hex), so leave those to it
+    std::size_t digits = 0;
+    for (value = 0; *arg >= '0' && *arg <= '9' && digits < 9; ++arg, ++digits) value = value * 10 + (*arg - '0');
+    return digits && !*arg;
+  };
+
+  std::array<std::size_t, 16> displays{};
+  std::size_t count = 0;
+  bool all = false;
+  int i = 1;
+  for (NvU32 display = 0; i < argc; ++i) {
+    if (is(argv[i], "-a") || is(argv[i], "--all")) all = true;
+    else if (!is(argv[i], "-d") && !is(argv[i], "--display")) break;
+    else if (i + 2 < argc && count < displays.size() && number(argv[i + 1], display)) displays[count++] = display, ++i;
+    else return false;
+  }
+
+  NvU32 value = 0;
+  if (i + 1 == argc && is(argv[i], "toggle")) nvdv::command = commands::Toggle{};
+  else if (i + 1 == argc && is(argv[i], "disable")) nvdv::command = commands::Disable{}, nvdv::write_only = true;
+  else if (i + 1 == argc && is(argv[i], "enable")) nvdv::command = commands::Enable{}, nvdv::write_only = true;
+  else if (i + 2 == argc && is(argv[i], "set") && number(argv[i + 1], value)) {
+    nvdv::command = commands::Set{}, nvdv::write_only = true;
+  } else return false;
+
+  nvdv::value_to_set = value;
+  nvdv::all = all;
+  nvdv::displays.assign(displays.begin(), displays.begin() + static_cast<std::ptrdiff_t>(count));
+  return true;
+}
+
+#ifdef NVDV_BENCHMARK
+static std::atomic<std::size_t> allocations = 0;
+
+void* operator new(const std::size_t size) {
+  ++allocations;
+  if (void* memory = std::malloc(size ? size : 1)) return memory;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+/** times `iterations` calls of `op`, printing p50/p99 latency and heap allocations per call */
+template <typename Op>
+static void measure(const char* name, const std::size_t iterations, Op op) {
+  using clock = std::chrono::steady_clock;
+  std::vector<double> samples(iterations);
+  const std::size_t allocated = allocations;
+  for (double& sample : samples) {
+    const clock::time_point start = clock::now();
+    op();
+    sample = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+  }
+
+  const double per_op = static_cast<double>(allocations - allocated) / static_cast<double>(iterations);
+  std::printf("%-28s p50 %10.0f ns  p99 %10.0f ns  %8.2f alloc/op\n", name, percentile(samples, 0.5),
+    percentile(samples, 0.99), per_op);
+}
+
+/** @returns number of integer/table conversions differing from the floating point reference over many ranges */
+static std::size_t check_conversions() {
+  std::size_t mismatches = 0;
+  NvU32 percents[101], values[101];
+  std::iota(std::begin(percents), std::end(percents), NvU32{0});
+  for (const NvU32 min : {0, 1, 13, 64}) {
+    for (NvU32 max = min + 1; max <= min + 4096; ++max) {
+      const DVC dvc = *DVC::open(nvdv::backend(), 1, {min, max});
+      for (NvU32 value = min; value <= max; ++value) {
+        mismatches += dvc.raw_to_percent(value) != DVC::rounded_percent(value, min, max);
+      }
+
+      dvc.percent_to_raw(percents, values, 101);
+      for (const NvU32 percent : percents) {
+        mismatches += dvc.percent_to_raw(percent) != DVC::rounded_raw(percent, min, max);
+        mismatches += values[percent] != DVC::rounded_raw(percent, min, max);
+      }
+    }
+  }
+
+  return mismatches;
+}
+
+/** parses `args` (in command line order) like a resident instance would */
+static void parse(CLI::App& app, std::vector<std::string> args) {
+  reset_command();
+  std::reverse(args.begin(), args.end());
+  app.parse(args);
+}
+
+/** benchmarks the command pipeline against the simulated backend (`NVDV_SIM_*` variables still apply) */
+int main() {
+#ifdef _WIN32
+  _putenv_s("NVDV_SIMULATE", "1");
+#endif
+  CLI::App app{APP_NAME};
+  define_commands(app);
+  volatile NvU32 sink = 0;
+
+  measure("parse set 50", 10000, [&] { parse(app, {"set", "50"}); });
+  const char* const fast_set[]{"nvdv", "set", "50"};
+  measure("parse_fast set 50", 10000, [&] { parse_fast(3, fast_set); });
+  const char* const fast_toggle[]{"nvdv", "-a", "toggle"};
+  measure("parse_fast -a toggle", 10000, [&] { parse_fast(3, fast_toggle); });
+  measure("parse -a set 1=40 2=raw:20", 10000, [&] { parse(app, {"-a", "set", "1=40", "2=raw:20"}); });
+  measure("parse info --format json", 10000, [&] { parse(app, {"info", "--format", "json"}); });
+
+  measure("init_dvc (primary)", 2000, [] {
+    nvdv::controllers.clear();
+    nvdv::displays.clear();
+    (void)init_dvc();
+  });
+
+  // what `main` runs for `nvdv set 50` once the driver context is up (containers keep their capacity, as in `serve`)
+  measure("end-to-end set 50", 2000, [&] {
+    nvdv::controllers.clear(), nvdv::selected.clear(), nvdv::phase_count = 0;
+    (void)parse_fast(3, fast_set);
+    if (init_dvc()) {
+      for (DVC& controller : nvdv::controllers) nvdv::selected.push_back(&controller);
+      run_controllers(nvdv::selected, false);
+    }
+
+    flush_writes();
+    mark_phase("command");
+    nvdv::output.clear();
+  });
+
+  measure("DVC construction", 20000, [] { (void)DVC::open(nvdv::backend(), 1); });
+  measure("DVC construction (cached)", 20000, [] { (void)DVC::open(nvdv::backend(), 1, {0, 63}); });
+
+  DVC& dvc = nvdv::controllers.front();
+  measure("raw_to_percent x101", 20000, [&] {
+    for (NvU32 raw = dvc.info.min; raw <= dvc.info.max; ++raw) sink = sink + dvc.raw_to_percent(raw);
+  });
+
+  measure("percent_to_raw x101", 20000, [&] {
+    for (NvU32 percent = 0; percent <= 100; ++percent) sink = sink + dvc.percent_to_raw(percent);
+  });
+
+  NvU32 percents[101], values[101];
+  std::iota(std::begin(percents), std::end(percents), NvU32{0});
+  measure("percent_to_raw batch x101", 20000, [&] {
+    dvc.percent_to_raw(percents, values, 101);
+    sink = sink + values[50];
+  });
+
+  measure("rounded_percent x101", 20000, [&] {
+    for (NvU32 raw = dvc.info.min; raw <= dvc.info.max; ++raw) {
+      sink = sink + DVC::rounded_percent(raw, dvc.info.min, dvc.info.max);
+    }
+  });
+
+  measure("rounded_raw x101", 20000, [&] {
+    for (NvU32 percent = 0; percent <= 100; ++percent) sink = sink + DVC::rounded_raw(percent, dvc.info.min, dvc.info.max);
+  });
+
+  for (const char* format : {"text", "json", "csv", "binary"}) {
+    parse(app, {"info", "--format", format});
+    const std::string name = std::string{"print_info "} + format;
+    measure(name.c_str(), 20000, [&] {
+      nvdv::output.clear();
+      (void)print_info(dvc);
+    });
+  }
+
+  parse(app, {"set", "50"});
+  measure("run_command set 50", 20000, [&] { (void)run_command(dvc); });
+  measure("run_command set 50 x64", 20000, [&] {
+    for (int i = 0; i < 64; ++i) (void)run_command(dvc);
+  });
+
+  parse(app, {"toggle"});
+  measure("run_command toggle", 20000, [&] { (void)run_command(dvc); });
+
+  const std::size_t mismatches = check_conversions();
+  std::printf("conversions %s: %zu mismatch(es) against the floating point reference\n", mismatches ? "FAILED" : "ok",
+    mismatches);
+  return mismatches ? 1 : 0;
+}
+#else
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[]) {
+#else
+int main(int argc, char* argv[]) {
+#endif
+  if (const std::optional<int> code = forward_to_server(argc, argv)) return *code;
+  static std::optional<CLI::App> app;
+  if (!parse_fast(argc, argv)) {
+    define_commands(app.emplace(APP_NAME));
+    const Trace::clock::time_point parse_start = Trace::clock::now();
+    CLI11_PARSE(*app, argc, argv);
+    if (!Trace::path.empty()) {
+      Trace::enabled = true, Trace::record("CLI11 parse", parse_start);
+      std::atexit(Trace::write), std::at_quick_exit(Trace::write);
+    }
+  }
+
+  mark_phase("parse");
+  // only once parsed, so `--help`, `--version` and usage errors never wait for another instance
+  if (const std::optional<int> code = ensure_single_instance(argc, argv)) return *code;
+  if (app && app->got_subcommand("serve")) return run_server(*app);
+  if (app && nvdv::read_stdin) return run_stdin(*app);
+  if (app && app->got_subcommand("profile")) return run_profiles(nvdv::events);
+  std::vector<DVC*>& selected = nvdv::selected;
+  const Result<> built = init_dvc();
+  if (built) {
+    for (DVC& dvc : nvdv::controllers) selected.push_back(&dvc);
+    if (!nvdv::keyframes.empty()) play_timeline(selected);
+    else run_controllers(selected, false);
+  }
+
+  flush_writes();
+  mark_phase("command");
+  if (nvdv::format == Format::binary) binary_stdout();
+  std::fwrite(nvdv::output.data(), 1, nvdv::output.size(), stdout);
+  const std::string failures = take_failures();  // every display was attempted, so report them together
+  std::fputs(failures.c_str(), stderr);
+  if (!built) std::fprintf(stderr, "Error: %s\n", built.error().reason.c_str());
+  if (nvdv::timings) {
+    print_phases();
+    if (nvdv::report) std::fputs(nvdv::report().c_str(), stderr);
+    std::fputs(level_counters(selected).c_str(), stderr);
+    std::fputs(write_counters().c_str(), stderr);
+    std::fputs(Watchdog::counters().c_str(), stderr);
+  }
+  if (nvdv::watch && built) std::fflush(stdout), cleanup(), watch(selected);  // read-only, so let other instances run
+  const int code = failures.empty() && built ? 0 : 1;
+  // abandoned driver threads may still be inside the backend, so leave it to the OS rather than destroying it
+  if (Watchdog::abandoned) std::fflush(stdout), std::quick_exit(code);
+  return code;
 }
+#endif